@@ -146,6 +146,64 @@ fixed point types so far:
   std::signbit
   std::copysign
   std::trunc
+
+
+For tracking down where precision is lost when porting floating point code,
+the shadow precision debug mode can be enabled by defining
+__FIXED_POINT_ENABLE_SHADOW__ before including this file.  Every fixed_point
+object then carries a double shadow value alongside its raw value, which is
+computed by doing the same operations in double precision.  The
+fixed_point::shadow function returns it.
+
+The divergence of a value from its shadow is recorded per source location
+with the FIXED_POINT_SHADOW_CHECK macro, which evaluates to its argument:
+
+  fxpt_16_16 func (fxpt_16_16 a, fxpt_16_16 b, fxpt_16_16 c)
+  {
+    return FIXED_POINT_SHADOW_CHECK (a * b + c);
+  }
+
+The worst divergence of each location is kept in the
+fixed_point_shadow_registry, both as absolute value and in units of the
+epsilon of the checked type:
+
+  for (std::size_t i = 0; i < fixed_point_shadow_registry::size (); ++i)
+  {
+    fixed_point_shadow_entry e = fixed_point_shadow_registry::entry (i);
+    printf ("%s:%u %g eps\n", e.file, e.line, e.max_error_eps);
+  }
+
+When __FIXED_POINT_ENABLE_SHADOW__ is not defined, the shadow value and the
+registry do not exist and FIXED_POINT_SHADOW_CHECK (x) expands to (x).
+The number of registry entries can be set with
+__FIXED_POINT_SHADOW_REGISTRY_SIZE__ (default 256).
+
+
+Overflow events can be counted by defining
+__FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__ before including this file.
+The events are counted per format and per operation:
+
+  add, sub	raw value addition and subtraction
+  mul		narrowing of a widened product
+  div		narrowing of a quotient
+  convert	narrowing conversion to another format
+  from_float	floating point value out of the format's range
+
+The overflow conditions are detected with the __builtin_*_overflow_p
+functions, which usually compile to a single flag test and a branch to the
+out of line counting code.  The events are counted for the result format.
+Each thread counts in its own slot using relaxed atomic stores, up to
+__FIXED_POINT_OVERFLOW_MAX_THREADS__ (default 64) threads.  Threads that do
+not get a slot share one with atomic increments.  The counters can be
+read per format with fixed_point_overflow_counters::count or written out in
+the Prometheus text format:
+
+  fixed_point_overflow_counters::count<fxpt_16_16> (FIXED_POINT_OVERFLOW_MUL);
+  fixed_point_overflow_counters::write_metrics (stdout);
+
+Events during constant evaluation are not counted.  When
+__FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__ is not defined, no code is
+generated for it.
 */
 
 #ifndef __FIXED_POINT_HPP_INCLUDED__
@@ -156,6 +214,43 @@ fixed point types so far:
 #include <cstdint>
 #include <cmath>
 
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+#include <cstddef>
+#include <cstring>
+
+#ifndef __FIXED_POINT_SHADOW_REGISTRY_SIZE__
+#define __FIXED_POINT_SHADOW_REGISTRY_SIZE__ 256
+#endif
+
+// passes the shadow value to the raw value constructor.
+#define __FIXED_POINT_SHADOW__(x) , (x)
+#define FIXED_POINT_SHADOW_CHECK(x) fixed_point_shadow_check ((x), __FILE__, __LINE__)
+#else
+#define __FIXED_POINT_SHADOW__(x)
+#define FIXED_POINT_SHADOW_CHECK(x) (x)
+#endif
+
+#ifdef __FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__
+#include <cstddef>
+#include <cstdio>
+
+#ifndef __FIXED_POINT_OVERFLOW_MAX_FORMATS__
+#define __FIXED_POINT_OVERFLOW_MAX_FORMATS__ 32
+#endif
+
+#ifndef __FIXED_POINT_OVERFLOW_MAX_THREADS__
+#define __FIXED_POINT_OVERFLOW_MAX_THREADS__ 64
+#endif
+
+// evaluates the overflow condition and counts the event for the format
+// given as the remaining arguments.  used as the left operand of a comma
+// operator in front of the actual operation.
+#define __FIXED_POINT_COUNT_OVERFLOW__(op, cond, ...) \
+  fixed_point_count_overflow<__VA_ARGS__> (op, cond),
+#else
+#define __FIXED_POINT_COUNT_OVERFLOW__(op, cond, ...)
+#endif
+
 #ifndef __FIXED_POINT_BEGIN_NAMESPACE__
 #define __FIXED_POINT_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
 #define __FIXED_POINT_BEGIN_NAMESPACE__ 
@@ -193,6 +288,215 @@ enum fixed_point_raw_init_tag
   FIXED_POINT_RAW
 };
 
+#ifdef __FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__
+
+enum fixed_point_overflow_op
+{
+  FIXED_POINT_OVERFLOW_ADD,
+  FIXED_POINT_OVERFLOW_SUB,
+  FIXED_POINT_OVERFLOW_MUL,		// narrowing of a widened product
+  FIXED_POINT_OVERFLOW_DIV,		// narrowing of a quotient
+  FIXED_POINT_OVERFLOW_CONVERT,		// narrowing convert_to
+  FIXED_POINT_OVERFLOW_FROM_FLOAT,	// floating point value out of range
+
+  FIXED_POINT_OVERFLOW_OP_COUNT
+};
+
+struct fixed_point_overflow_format
+{
+  unsigned integral_bits;
+  unsigned fractional_bits;
+  bool is_signed;
+  bool is_widened;
+};
+
+template <typename Dummy = void> class fixed_point_overflow_counters_t
+{
+public:
+  static constexpr std::size_t max_formats = __FIXED_POINT_OVERFLOW_MAX_FORMATS__;
+  static constexpr std::size_t max_threads = __FIXED_POINT_OVERFLOW_MAX_THREADS__;
+
+  // count an overflow event of the fixed point type X.
+  template <typename X> __attribute__ ((noinline, cold))
+  static void record (fixed_point_overflow_op op) noexcept
+  {
+    const std::size_t f = format_id<X> ();
+    if (f >= max_formats)
+    {
+      __atomic_fetch_add (&__dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+    // only the owning thread writes to its slot, a plain load and store
+    // is enough.  threads without a slot share the last one.
+    const std::size_t t = thread_slot ();
+    std::uint64_t& c = __slots[t].count[f][op];
+    if (t < max_threads)
+      __atomic_store_n (&c, __atomic_load_n (&c, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    else
+      __atomic_fetch_add (&c, 1, __ATOMIC_RELAXED);
+  }
+
+  template <typename X> static std::uint64_t count (fixed_point_overflow_op op) noexcept
+  {
+    return count (format_id<X> (), op);
+  }
+
+  // sum of all threads.
+  static std::uint64_t count (std::size_t format, fixed_point_overflow_op op) noexcept
+  {
+    std::uint64_t c = 0;
+    if (format < max_formats)
+      for (std::size_t t = 0; t <= max_threads; ++t)
+	c += __atomic_load_n (&__slots[t].count[format][op], __ATOMIC_RELAXED);
+    return c;
+  }
+
+  static std::size_t format_count (void) noexcept
+  {
+    const std::size_t n = __atomic_load_n (&__format_count, __ATOMIC_ACQUIRE);
+    return n < max_formats ? n : max_formats;
+  }
+
+  static fixed_point_overflow_format format (std::size_t i) noexcept
+  {
+    return __formats[i];
+  }
+
+  // number of events that have not been counted because there were too
+  // many formats.
+  static std::uint64_t dropped (void) noexcept
+  {
+    return __atomic_load_n (&__dropped, __ATOMIC_RELAXED);
+  }
+
+  static const char* op_name (fixed_point_overflow_op op) noexcept
+  {
+    static const char* const names[FIXED_POINT_OVERFLOW_OP_COUNT] =
+    {
+      "add", "sub", "mul", "div", "convert", "from_float"
+    };
+    return names[op];
+  }
+
+  // write all non-zero counters in the Prometheus text format, e.g.
+  //   fixed_point_overflow_total{format="s16.16",op="add"} 3
+  static void write_metrics (std::FILE* out, const char* name = "fixed_point_overflow_total")
+  {
+    std::fprintf (out, "# TYPE %s counter\n", name);
+    for (std::size_t f = 0; f < format_count (); ++f)
+      for (unsigned op = 0; op < FIXED_POINT_OVERFLOW_OP_COUNT; ++op)
+      {
+	const std::uint64_t c = count (f, fixed_point_overflow_op (op));
+	if (c != 0)
+	  std::fprintf (out, "%s{format=\"%c%u.%u%s\",op=\"%s\"} %llu\n", name,
+			__formats[f].is_signed ? 's' : 'u',
+			__formats[f].integral_bits, __formats[f].fractional_bits,
+			__formats[f].is_widened ? "w" : "",
+			op_name (fixed_point_overflow_op (op)), (unsigned long long)c);
+      }
+  }
+
+  // not synchronized with concurrent events.
+  static void reset (void) noexcept
+  {
+    for (std::size_t t = 0; t <= max_threads; ++t)
+      for (std::size_t f = 0; f < max_formats; ++f)
+	for (unsigned op = 0; op < FIXED_POINT_OVERFLOW_OP_COUNT; ++op)
+	  __atomic_store_n (&__slots[t].count[f][op], 0, __ATOMIC_RELAXED);
+    __atomic_store_n (&__dropped, 0, __ATOMIC_RELAXED);
+  }
+
+private:
+  struct alignas (64) slot
+  {
+    std::uint64_t count[max_formats][FIXED_POINT_OVERFLOW_OP_COUNT];
+  };
+
+  // claims a slot for the lifetime of a thread.  the counts are left in the
+  // slot when the thread exits and a new thread continues to add to them.
+  struct slot_owner
+  {
+    std::size_t index;
+
+    slot_owner (void) noexcept : index (max_threads)
+    {
+      for (std::size_t t = 0; t < max_threads; ++t)
+	if (!__atomic_test_and_set (&__slot_used[t], __ATOMIC_ACQUIRE))
+	{
+	  index = t;
+	  break;
+	}
+    }
+
+    ~slot_owner (void)
+    {
+      if (index < max_threads)
+	__atomic_clear (&__slot_used[index], __ATOMIC_RELEASE);
+    }
+  };
+
+  static std::size_t thread_slot (void) noexcept
+  {
+    static thread_local slot_owner owner;
+    return owner.index;
+  }
+
+  template <typename X> static std::size_t format_id (void) noexcept
+  {
+    static const std::size_t id = add_format (X::integral_bits, X::fractional_bits,
+					      std::is_signed<typename X::raw_type>::value,
+					      X::is_widened);
+    return id;
+  }
+
+  static std::size_t add_format (unsigned i, unsigned f, bool is_signed, bool is_widened) noexcept
+  {
+    while (__atomic_test_and_set (&__format_lock, __ATOMIC_ACQUIRE))
+      ;
+    const std::size_t id = __format_count;
+    if (id < max_formats)
+    {
+      __formats[id] = fixed_point_overflow_format { i, f, is_signed, is_widened };
+      __atomic_store_n (&__format_count, id + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_clear (&__format_lock, __ATOMIC_RELEASE);
+    return id;
+  }
+
+  static slot __slots[max_threads + 1];
+  static bool __slot_used[max_threads];
+  static fixed_point_overflow_format __formats[max_formats];
+  static std::size_t __format_count;
+  static bool __format_lock;
+  static std::uint64_t __dropped;
+};
+
+template <typename Dummy>
+typename fixed_point_overflow_counters_t<Dummy>::slot
+fixed_point_overflow_counters_t<Dummy>::__slots[max_threads + 1];
+
+template <typename Dummy> bool fixed_point_overflow_counters_t<Dummy>::__slot_used[max_threads];
+
+template <typename Dummy>
+fixed_point_overflow_format fixed_point_overflow_counters_t<Dummy>::__formats[max_formats];
+
+template <typename Dummy> std::size_t fixed_point_overflow_counters_t<Dummy>::__format_count = 0;
+template <typename Dummy> bool fixed_point_overflow_counters_t<Dummy>::__format_lock = false;
+template <typename Dummy> std::uint64_t fixed_point_overflow_counters_t<Dummy>::__dropped = 0;
+
+typedef fixed_point_overflow_counters_t<> fixed_point_overflow_counters;
+
+// the events are not counted during constant evaluation.
+template <typename X>
+inline constexpr bool fixed_point_count_overflow (fixed_point_overflow_op op, bool overflow) noexcept
+{
+  return __builtin_expect (overflow, false) && !__builtin_is_constant_evaluated ()
+	 ? (fixed_point_overflow_counters::record<X> (op), true) : false;
+}
+
+#endif // __FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__
+
 template <typename T, unsigned I, unsigned F, bool W> class fixed_point;
 
 // empty partial specialization to avoid problems when instantiating 
@@ -219,6 +523,10 @@ public:
 protected:
   T value;
 
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+  double shadow_value;
+#endif
+
   typedef typename fixed_point_widened_raw_type<raw_type>::type widened_raw_type;
   typedef typename fixed_point_narrowed_raw_type<raw_type>::type narrowed_raw_type;
 
@@ -259,9 +567,27 @@ protected:
       return static_cast<otherT> (raw_type (1) << fractional_bits);
     }
 
+#ifdef __FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__
+    typedef typename std::remove_cv<otherT>::type float_type;
+
+    // 2^digits of the raw type.
+    static constexpr float_type raw_limit (void) noexcept
+    {
+      return static_cast<float_type> (std::uintmax_t (1) << (std::numeric_limits<raw_type>::digits - 1)) * 2;
+    }
+
+    static constexpr bool out_of_range (const float_type& value) noexcept
+    {
+      return !(value < raw_limit ()
+	       && (std::is_signed<raw_type>::value ? value >= -raw_limit () : value > -1));
+    }
+#endif
+
     static constexpr raw_type from (const otherT& value) noexcept
     {
-      return static_cast<raw_type> (value * one ());
+      return (__FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_FROM_FLOAT,
+					      out_of_range (value * one ()), fixed_point)
+	      static_cast<raw_type> (value * one ()));
     }
 
     static constexpr otherT to (const raw_type& value) noexcept
@@ -279,21 +605,37 @@ public:
 
   constexpr explicit fixed_point (const raw_type& _raw_value, fixed_point_raw_init_tag) noexcept
     : value (_raw_value)
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+    , shadow_value (cast<double>::to (_raw_value))
+#endif
   { }
 
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+  constexpr explicit fixed_point (const raw_type& _raw_value, fixed_point_raw_init_tag,
+				  double _shadow_value) noexcept
+    : value (_raw_value), shadow_value (_shadow_value)
+  { }
+#endif
+
   // construction from other fixed_point type is explicit
   // ???: explicit if truncating (otherI > I || otherF > F)
   //		implicit if promoting (otherI <= I && otherF <= F)
   template <typename otherT, unsigned otherI, unsigned otherF, bool otherW>
   constexpr explicit fixed_point (const fixed_point<otherT, otherI, otherF, otherW>& other) noexcept
 //: value ( ((fixed_point)other).raw () )	// this causes an infinite loop
-  : value (other.convert_to<raw_type, integral_bits, fractional_bits, is_widened> ().raw ())
+  : value (other.template convert_to<raw_type, integral_bits, fractional_bits, is_widened> ().raw ())
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+  , shadow_value (other.shadow ())
+#endif
   { }
 
   // construction from integral or floating point type is implicit
   template <typename otherT>
   constexpr fixed_point (const otherT& other_value) noexcept
     : value (cast<otherT>::from(other_value))
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+    , shadow_value (static_cast<double> (other_value))
+#endif
   { }
 
   // conversion to another fixed_point type must be explicit
@@ -373,7 +715,10 @@ public:
   // fixed_point + fixed_point -> fixed_point
   constexpr friend const fixed_point operator + (const fixed_point& lhs, const fixed_point& rhs) noexcept
   {
-    return fixed_point (lhs.value + rhs.value, FIXED_POINT_RAW);
+    return fixed_point ((__FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_ADD,
+			  __builtin_add_overflow_p (lhs.value, rhs.value, raw_type (0)), fixed_point)
+			 lhs.value + rhs.value), FIXED_POINT_RAW
+			__FIXED_POINT_SHADOW__ (lhs.shadow_value + rhs.shadow_value));
   }
 
   // widened_fixed + (widened_fixed)fixed_point -> widened_fixed
@@ -422,13 +767,16 @@ let the compiler figure it out, it can do a better job at it.
   // unary minus
   const fixed_point operator - (void) const noexcept
   {
-    return fixed_point (-value, FIXED_POINT_RAW);
+    return fixed_point (-value, FIXED_POINT_RAW __FIXED_POINT_SHADOW__ (-shadow_value));
   }
 
   // fixed - fixed -> fixed
   constexpr friend const fixed_point operator - (const fixed_point& lhs, const fixed_point& rhs) noexcept
   {
-    return fixed_point (lhs.value - rhs.value, FIXED_POINT_RAW);
+    return fixed_point ((__FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_SUB,
+			  __builtin_sub_overflow_p (lhs.value, rhs.value, raw_type (0)), fixed_point)
+			 lhs.value - rhs.value), FIXED_POINT_RAW
+			__FIXED_POINT_SHADOW__ (lhs.shadow_value - rhs.shadow_value));
   }
 
   // widened_fixed - (widened_fixed)fixed -> widened_fixed
@@ -457,7 +805,12 @@ let the compiler figure it out, it can do a better job at it.
 
   fixed_point& operator -= (const fixed_point& rhs) noexcept
   {
+    __FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_SUB,
+				    __builtin_sub_overflow_p (value, rhs.value, raw_type (0)), fixed_point)
     value -= rhs.value;
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+    shadow_value -= rhs.shadow_value;
+#endif
     return *this;
   }
 
@@ -487,7 +840,8 @@ let the compiler figure it out, it can do a better job at it.
     static_assert (!std::is_void <widened_raw_type>::value
 		   , "widened type for multiplication result is not available");
     return widened_fixed_type (static_cast<widened_raw_type>(lhs.raw ())
-			       * static_cast<widened_raw_type>(rhs.raw ()), FIXED_POINT_RAW);
+			       * static_cast<widened_raw_type>(rhs.raw ()), FIXED_POINT_RAW
+			       __FIXED_POINT_SHADOW__ (lhs.shadow () * rhs.shadow ()));
   }
 
   fixed_point& operator *= (const fixed_point& rhs) noexcept
@@ -528,7 +882,8 @@ let the compiler figure it out, it can do a better job at it.
   operator * (const fixed_point& lhs, const otherT& rhs) noexcept
   {
     return widened_fixed_type (static_cast<widened_raw_type>(lhs.raw ())
-			       * static_cast<widened_raw_type>(rhs), FIXED_POINT_RAW);
+			       * static_cast<widened_raw_type>(rhs), FIXED_POINT_RAW
+			       __FIXED_POINT_SHADOW__ (lhs.shadow () * rhs));
   }
 
   template <typename otherT>
@@ -619,7 +974,11 @@ let the compiler figure it out, it can do a better job at it.
 		 , const fixed_point>::type
   operator / (const otherT& lhs, const otherT& rhs) noexcept
   {
-    return fixed_point ((static_cast<widened_raw_type>(lhs.raw ()) << fractional_bits) / rhs.raw (), FIXED_POINT_RAW);
+    return fixed_point ((__FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_DIV,
+			  __builtin_add_overflow_p ((static_cast<widened_raw_type>(lhs.raw ()) << fractional_bits) / rhs.raw (),
+						    0, raw_type (0)), fixed_point)
+			 (static_cast<widened_raw_type>(lhs.raw ()) << fractional_bits) / rhs.raw ()), FIXED_POINT_RAW
+			__FIXED_POINT_SHADOW__ (lhs.shadow () / rhs.shadow ()));
   }
 
   fixed_point& operator /= (const fixed_point& rhs) noexcept
@@ -638,7 +997,11 @@ let the compiler figure it out, it can do a better job at it.
 		 , const narrowed_fixed_type>::type
   operator / (const otherT& lhs, const otherR& rhs) noexcept
   {
-    return narrowed_fixed_type (lhs.raw () / rhs.raw (), FIXED_POINT_RAW);
+    return narrowed_fixed_type ((__FIXED_POINT_COUNT_OVERFLOW__ (FIXED_POINT_OVERFLOW_DIV,
+				  __builtin_add_overflow_p (lhs.raw () / rhs.raw (), 0, narrowed_raw_type (0)),
+				  narrowed_fixed_type)
+				 lhs.raw () / rhs.raw ()), FIXED_POINT_RAW
+				__FIXED_POINT_SHADOW__ (lhs.shadow () / rhs.shadow ()));
   }
 
   // fixed / (fixed)widened -> fixed
@@ -670,7 +1033,7 @@ let the compiler figure it out, it can do a better job at it.
   constexpr friend typename std::enable_if <std::is_integral<otherT>::value, const fixed_point>::type
   operator / (const fixed_point& lhs, const otherT& rhs) noexcept
   {
-    return fixed_point (lhs.raw () / rhs, FIXED_POINT_RAW);
+    return fixed_point (lhs.raw () / rhs, FIXED_POINT_RAW __FIXED_POINT_SHADOW__ (lhs.shadow () / rhs));
   }
 
   template <typename otherT>
@@ -721,6 +1084,11 @@ let the compiler figure it out, it can do a better job at it.
 
   constexpr const raw_type& raw (void) const noexcept { return value; }
 
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+  // the value computed with double precision operations.
+  constexpr double shadow (void) const noexcept { return shadow_value; }
+#endif
+
 
   // have to leave the convert_to public although it is supposed
   // to be used privately.
@@ -731,7 +1099,11 @@ let the compiler figure it out, it can do a better job at it.
   std::enable_if<(destF == fractional_bits), fixed_point<destT, destI, destF, destW>>::type
   convert_to (void) const noexcept
   {
-    return fixed_point<destT, destI, destF, destW> (static_cast<destT> (value), FIXED_POINT_RAW);
+    return fixed_point<destT, destI, destF, destW> ((__FIXED_POINT_COUNT_OVERFLOW__ (is_widened && !destW ? FIXED_POINT_OVERFLOW_MUL : FIXED_POINT_OVERFLOW_CONVERT,
+						     __builtin_add_overflow_p (value, 0, destT (0)),
+						     fixed_point<destT, destI, destF, destW>)
+						     static_cast<destT> (value)), FIXED_POINT_RAW
+						    __FIXED_POINT_SHADOW__ (shadow_value));
   }
 
   // increase number of fractional bits -> left shift
@@ -743,7 +1115,11 @@ let the compiler figure it out, it can do a better job at it.
   constexpr typename std::enable_if<(destF > fractional_bits), fixed_point<destT, destI, destF, destW>>::type
   convert_to (void) const noexcept
   {
-    return fixed_point<destT, destI, destF, destW> (static_cast<destT> (value) << (destF - fractional_bits), FIXED_POINT_RAW);
+    return fixed_point<destT, destI, destF, destW> ((__FIXED_POINT_COUNT_OVERFLOW__ (is_widened && !destW ? FIXED_POINT_OVERFLOW_MUL : FIXED_POINT_OVERFLOW_CONVERT,
+						     __builtin_mul_overflow_p (value, std::uintmax_t (1) << (destF - fractional_bits), destT (0)),
+						     fixed_point<destT, destI, destF, destW>)
+						     static_cast<destT> (value) << (destF - fractional_bits)), FIXED_POINT_RAW
+						    __FIXED_POINT_SHADOW__ (shadow_value));
   }
 
   // decrease number of fractional bits -> right shift
@@ -754,10 +1130,160 @@ let the compiler figure it out, it can do a better job at it.
   constexpr typename std::enable_if<(destF < fractional_bits), fixed_point<destT, destI, destF, destW>>::type
   convert_to (void) const noexcept
   {
-    return fixed_point<destT, destI, destF, destW> (static_cast<destT> (value >> (fractional_bits - destF)), FIXED_POINT_RAW);
+    return fixed_point<destT, destI, destF, destW> ((__FIXED_POINT_COUNT_OVERFLOW__ (is_widened && !destW ? FIXED_POINT_OVERFLOW_MUL : FIXED_POINT_OVERFLOW_CONVERT,
+						     __builtin_add_overflow_p (value >> (fractional_bits - destF), 0, destT (0)),
+						     fixed_point<destT, destI, destF, destW>)
+						     static_cast<destT> (value >> (fractional_bits - destF))), FIXED_POINT_RAW
+						    __FIXED_POINT_SHADOW__ (shadow_value));
   }
 };
 
+#ifdef __FIXED_POINT_ENABLE_SHADOW__
+
+struct fixed_point_shadow_entry
+{
+  const char* file;
+  unsigned line;
+  unsigned long long count;	// number of checks
+  double max_error;		// worst absolute divergence
+  double max_error_eps;		// worst divergence in epsilons of the checked type
+  double value;			// value at the worst divergence
+  double shadow;		// shadow value at the worst divergence
+};
+
+template <typename Dummy = void> class fixed_point_shadow_registry_t
+{
+public:
+  static constexpr std::size_t capacity = __FIXED_POINT_SHADOW_REGISTRY_SIZE__;
+
+  // record the divergence of a value at a source location.
+  static void record (const char* file, unsigned line, double value, double shadow,
+		      double eps) noexcept
+  {
+    const double err = std::fabs (value - shadow);
+
+    lock ();
+    fixed_point_shadow_entry* e = find (file, line);
+    if (e == nullptr)
+      ++__dropped;
+    else
+    {
+      ++e->count;
+      if (e->count == 1 || err > e->max_error)
+      {
+	e->max_error = err;
+	e->max_error_eps = err / eps;
+	e->value = value;
+	e->shadow = shadow;
+      }
+    }
+    unlock ();
+  }
+
+  static std::size_t size (void) noexcept
+  {
+    return __atomic_load_n (&__size, __ATOMIC_ACQUIRE);
+  }
+
+  static fixed_point_shadow_entry entry (std::size_t i) noexcept
+  {
+    lock ();
+    const fixed_point_shadow_entry e = __entries[i];
+    unlock ();
+    return e;
+  }
+
+  // the entry with the largest divergence in epsilons.
+  static fixed_point_shadow_entry worst (void) noexcept
+  {
+    fixed_point_shadow_entry w = { nullptr, 0, 0, 0, 0, 0, 0 };
+    lock ();
+    for (std::size_t i = 0; i < __size; ++i)
+      if (w.file == nullptr || __entries[i].max_error_eps > w.max_error_eps)
+	w = __entries[i];
+    unlock ();
+    return w;
+  }
+
+  // number of checks that have not been recorded because the registry
+  // was full.
+  static unsigned long long dropped (void) noexcept
+  {
+    lock ();
+    const unsigned long long d = __dropped;
+    unlock ();
+    return d;
+  }
+
+  static void clear (void) noexcept
+  {
+    lock ();
+    __size = 0;
+    __dropped = 0;
+    unlock ();
+  }
+
+private:
+  static void lock (void) noexcept
+  {
+    while (__atomic_test_and_set (&__lock, __ATOMIC_ACQUIRE))
+      ;
+  }
+
+  static void unlock (void) noexcept
+  {
+    __atomic_clear (&__lock, __ATOMIC_RELEASE);
+  }
+
+  // the same source location can have different file name pointers in
+  // different translation units.
+  static fixed_point_shadow_entry* find (const char* file, unsigned line) noexcept
+  {
+    for (std::size_t i = 0; i < __size; ++i)
+      if (__entries[i].line == line
+	  && (__entries[i].file == file || std::strcmp (__entries[i].file, file) == 0))
+	return &__entries[i];
+
+    if (__size == capacity)
+      return nullptr;
+
+    fixed_point_shadow_entry& e = __entries[__size];
+    e.file = file;
+    e.line = line;
+    e.count = 0;
+    e.max_error = e.max_error_eps = 0;
+    e.value = e.shadow = 0;
+    __atomic_store_n (&__size, __size + 1, __ATOMIC_RELEASE);
+    return &e;
+  }
+
+  static fixed_point_shadow_entry __entries[capacity];
+  static std::size_t __size;
+  static unsigned long long __dropped;
+  static bool __lock;
+};
+
+template <typename Dummy>
+fixed_point_shadow_entry fixed_point_shadow_registry_t<Dummy>::__entries[capacity];
+
+template <typename Dummy> std::size_t fixed_point_shadow_registry_t<Dummy>::__size = 0;
+template <typename Dummy> unsigned long long fixed_point_shadow_registry_t<Dummy>::__dropped = 0;
+template <typename Dummy> bool fixed_point_shadow_registry_t<Dummy>::__lock = false;
+
+typedef fixed_point_shadow_registry_t<> fixed_point_shadow_registry;
+
+// used by FIXED_POINT_SHADOW_CHECK, found by argument dependent lookup.
+template <typename T, unsigned I, unsigned F, bool W>
+inline fixed_point<T, I, F, W>
+fixed_point_shadow_check (const fixed_point<T, I, F, W>& x, const char* file, unsigned line) noexcept
+{
+  fixed_point_shadow_registry::record (file, line, static_cast<double> (x), x.shadow (),
+				       std::ldexp (1.0, -static_cast<int> (F)));
+  return x;
+}
+
+#endif // __FIXED_POINT_ENABLE_SHADOW__
+
 __FIXED_POINT_END_NAMESPACE__
 
 
@@ -944,28 +1470,32 @@ template <typename T, unsigned I, unsigned F, bool W>
 inline constexpr __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>
 min (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& a, const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& b) noexcept
 {
-  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () < b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () < b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW
+								 __FIXED_POINT_SHADOW__ (a.raw () < b.raw () ? a.shadow () : b.shadow ()));
 }
 
 template <typename T, unsigned I, unsigned F, bool W>
 inline constexpr __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>
 fmin (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& a, const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& b) noexcept
 {
-  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () < b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () < b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW
+								 __FIXED_POINT_SHADOW__ (a.raw () < b.raw () ? a.shadow () : b.shadow ()));
 }
 
 template <typename T, unsigned I, unsigned F, bool W>
 inline constexpr __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>
 max (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& a, const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& b) noexcept
 {
-  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () > b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () > b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW
+								 __FIXED_POINT_SHADOW__ (a.raw () > b.raw () ? a.shadow () : b.shadow ()));
 }
 
 template <typename T, unsigned I, unsigned F, bool W>
 inline constexpr __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>
 fmax (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& a, const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& b) noexcept
 {
-  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () > b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () > b.raw () ? a.raw () : b.raw (), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW
+								 __FIXED_POINT_SHADOW__ (a.raw () > b.raw () ? a.shadow () : b.shadow ()));
 }
 
 
@@ -1291,7 +1821,8 @@ template <typename T, unsigned I, unsigned F, bool W>
 inline constexpr __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>
 trunc (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& a) noexcept
 {
-  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () & a.integral_mask, __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  return __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> (a.raw () & a.integral_mask, __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW
+								 __FIXED_POINT_SHADOW__ (std::trunc (a.shadow ())));
 }
 
 /*
@@ -1466,5 +1997,8 @@ copysign (const __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>& x,
 #undef __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
 #endif
 
+#undef __FIXED_POINT_SHADOW__
+#undef __FIXED_POINT_COUNT_OVERFLOW__
+
 #endif // __FIXED_POINT_HPP_INCLUDED__
 
@@ -0,0 +1,417 @@
+/*
+--------------------------------------------------------------------------------
+
+Fixed point arithmetic benchmark
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 fixed_point_bench.cpp
+
+Usage:
+  ./a.out [--format text|csv|json] [--iterations N] [--filter SUBSTRING]
+
+Every operator and conversion is measured for the fixed point formats of
+fixed_point_compile_tests.cpp and for float, double and raw integer baselines:
+
+  - latency: a dependent chain x = op (x, b[i]).
+  - throughput: an array loop c[i] = op (a[i], b[i]) over 1024 elements,
+    which the compiler may vectorize.
+
+Conversions are measured as round trips, e.g. T -> float -> T, with an
+optimization barrier on the intermediate value.  Their array loops are thus
+not vectorized.
+
+The results are the best of several rounds in ns per operation.  The csv and
+json formats are meant for tracking regressions between commits, e.g.
+
+  ./a.out --format json > bench-$(git rev-parse --short HEAD).json
+
+Operations that a format does not support (e.g. the multiplication of 64-bit
+fixed point types, which has no widened type) are not reported.
+
+--------------------------------------------------------------------------------
+*/
+
+#include "fixed_point.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef fixed_point<int32_t, 16, 16> fxpt_16_16;
+typedef fixed_point<int32_t, 8, 24> fxpt_8_24;
+typedef fixed_point<int64_t, 32, 32> fxpt_32_32;
+typedef fixed_point<int32_t, 9, 23> fxpt_9_23;
+typedef fixed_point<int8_t, 4, 4> fxpt_4_4;
+typedef fixed_point<int16_t, 8, 8> fxpt_8_8;
+typedef fixed_point<uint32_t, 16, 16> fxptu_16_16;
+
+#define BENCH_NOINLINE __attribute__ ((noinline))
+
+static const std::size_t array_size = 1024;
+
+// ---------------------------------------------------------------------------
+// type properties.
+
+template <typename T> struct bench_type_info
+{
+  static constexpr bool is_fixed = false;
+  static constexpr bool has_mul = true;
+  static constexpr bool has_convert = false;
+};
+
+template <typename T, unsigned I, unsigned F, bool W> struct bench_type_info<fixed_point<T, I, F, W>>
+{
+  static constexpr bool is_fixed = true;
+  // multiplication and division need the widened raw type.
+  static constexpr bool has_mul = sizeof (T) < 8;
+  // conversions instantiate the narrowed type, which needs even bit counts.
+  static constexpr bool has_convert = sizeof (T) < 8 && I % 2 == 0 && F % 2 == 0;
+};
+
+// input values.  signed types get alternating signs so that add / sub chains
+// stay in range, raw integers get values that do not divide to zero at once.
+template <typename T> static T bench_value (std::size_t i)
+{
+  const double v = 0.5 + double ((i * 2654435761u) % 1000) / 1000;
+  const double s = std::is_signed<T>::value && (i & 1) ? -v : v;
+  return std::is_integral<T>::value ? T (s * 16) : T (s);
+}
+
+// hide the value of x from the optimizer without any instructions, so that a
+// chain of operations is not turned into a reduction and round trip
+// conversions are not folded.
+template <std::size_t N> struct bench_uint_of_size;
+template <> struct bench_uint_of_size<1> { typedef uint8_t type; };
+template <> struct bench_uint_of_size<2> { typedef uint16_t type; };
+template <> struct bench_uint_of_size<4> { typedef uint32_t type; };
+template <> struct bench_uint_of_size<8> { typedef uint64_t type; };
+
+template <typename T> inline void bench_opaque (T& x, std::false_type)
+{
+  typename bench_uint_of_size<sizeof (T)>::type u;
+  std::memcpy (&u, static_cast<void*> (&x), sizeof (T));
+  asm volatile ("" : "+r" (u));
+  std::memcpy (static_cast<void*> (&x), &u, sizeof (T));
+}
+
+template <typename T> inline void bench_opaque (T& x, std::true_type)
+{
+#if defined (__SSE2__)
+  asm volatile ("" : "+x" (x));
+#else
+  asm volatile ("" : "+m" (x));
+#endif
+}
+
+template <typename T> inline void bench_opaque (T& x)
+{
+  bench_opaque (x, std::is_floating_point<T> ());
+}
+
+template <typename T> inline T bench_opaque_value (T x)
+{
+  bench_opaque (x);
+  return x;
+}
+
+// ---------------------------------------------------------------------------
+// operations.  supported<T> tells whether the type has the operation.
+
+struct op_add
+{
+  static const char* name (void) { return "add"; }
+  template <typename T> struct supported : std::true_type { };
+  template <typename T> static T apply (const T& a, const T& b) { return a + b; }
+};
+
+struct op_sub
+{
+  static const char* name (void) { return "sub"; }
+  template <typename T> struct supported : std::true_type { };
+  template <typename T> static T apply (const T& a, const T& b) { return a - b; }
+};
+
+struct op_mul
+{
+  static const char* name (void) { return "mul"; }
+  template <typename T> struct supported : std::integral_constant<bool, bench_type_info<T>::has_mul> { };
+  template <typename T> static T apply (const T& a, const T& b) { return (T)(a * b); }
+};
+
+struct op_div
+{
+  static const char* name (void) { return "div"; }
+  template <typename T> struct supported : std::integral_constant<bool, bench_type_info<T>::has_mul> { };
+  template <typename T> static T apply (const T& a, const T& b) { return a / b; }
+};
+
+struct op_mul_int
+{
+  static const char* name (void) { return "mul_int"; }
+  template <typename T> struct supported : std::integral_constant<bool, bench_type_info<T>::has_mul> { };
+  template <typename T> static T apply (const T& a, const T&) { return (T)(a * 3); }
+};
+
+struct op_div_int
+{
+  static const char* name (void) { return "div_int"; }
+  template <typename T> struct supported : std::true_type { };
+  template <typename T> static T apply (const T& a, const T&) { return a / 3; }
+};
+
+struct op_neg
+{
+  static const char* name (void) { return "neg"; }
+  template <typename T> struct supported : std::is_signed<T> { };
+  template <typename T> static T apply (const T& a, const T&) { return -a; }
+};
+
+struct op_less
+{
+  static const char* name (void) { return "less"; }
+  template <typename T> struct supported : std::true_type { };
+  template <typename T> static T apply (const T& a, const T& b) { return a < b ? a : b; }
+};
+
+// conversions, as round trips through the other type.
+struct op_float
+{
+  static const char* name (void) { return "float"; }
+  template <typename T> struct supported : std::integral_constant<bool, !std::is_same<T, float>::value> { };
+  template <typename T> static T apply (const T& a, const T&) { return T (bench_opaque_value (static_cast<float> (a))); }
+};
+
+struct op_double
+{
+  static const char* name (void) { return "double"; }
+  template <typename T> struct supported : std::integral_constant<bool, !std::is_same<T, double>::value> { };
+  template <typename T> static T apply (const T& a, const T&) { return T (bench_opaque_value (static_cast<double> (a))); }
+};
+
+struct op_int
+{
+  static const char* name (void) { return "int"; }
+  template <typename T> struct supported : std::integral_constant<bool, !std::is_integral<T>::value> { };
+  template <typename T> static T apply (const T& a, const T&) { return T (bench_opaque_value (static_cast<int> (a))); }
+};
+
+struct op_convert
+{
+  static const char* name (void) { return "convert"; }
+  template <typename T> struct supported : std::integral_constant<bool, bench_type_info<T>::has_convert> { };
+  template <typename T> static T apply (const T& a, const T&) { return T (bench_opaque_value (fxpt_32_32 (a))); }
+};
+
+// ---------------------------------------------------------------------------
+// measurement.
+
+template <typename T> struct bench_data
+{
+  T a[array_size];
+  T b[array_size];
+  T c[array_size];
+
+  bench_data (void)
+  {
+    for (std::size_t i = 0; i < array_size; ++i)
+    {
+      a[i] = bench_value<T> (i);
+      b[i] = bench_value<T> (i + 1);	// paired with a different value
+    }
+  }
+};
+
+template <typename Op, typename T> BENCH_NOINLINE T latency_loop (const bench_data<T>& d, std::size_t n)
+{
+  T x = d.a[0];
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    x = Op::apply (x, d.b[i & (array_size - 1)]);
+    bench_opaque (x);
+  }
+  return x;
+}
+
+template <typename Op, typename T> BENCH_NOINLINE void throughput_loop (bench_data<T>& d, std::size_t n)
+{
+  for (std::size_t r = 0; r < n / array_size; ++r)
+  {
+    for (std::size_t i = 0; i < array_size; ++i)
+      d.c[i] = Op::apply (d.a[i], d.b[i]);
+    bench_opaque (d.c[r & (array_size - 1)]);
+  }
+}
+
+enum bench_format { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON };
+
+struct bench_config
+{
+  bench_format format;
+  std::size_t iterations;
+  const char* filter;
+  unsigned result_count;
+};
+
+static volatile unsigned char bench_sink;
+
+static void report (bench_config& cfg, const char* type, const char* op, const char* mode, double ns)
+{
+  switch (cfg.format)
+  {
+    case FORMAT_TEXT:
+      std::printf ("%-12s %-10s %-10s %8.3f\n", type, op, mode, ns);
+      break;
+    case FORMAT_CSV:
+      std::printf ("%s,%s,%s,%.4f\n", type, op, mode, ns);
+      break;
+    case FORMAT_JSON:
+      std::printf ("%s\n  {\"type\":\"%s\",\"op\":\"%s\",\"mode\":\"%s\",\"ns_per_op\":%.4f}",
+		   cfg.result_count == 0 ? "" : ",", type, op, mode, ns);
+      break;
+  }
+  ++cfg.result_count;
+}
+
+template <typename Op, typename T>
+static void run_op (bench_config& cfg, const char* type, bench_data<T>& d, std::true_type)
+{
+  const std::string name = std::string (type) + " " + Op::name ();
+  if (cfg.filter != nullptr && name.find (cfg.filter) == std::string::npos)
+    return;
+
+  const std::size_t n = cfg.iterations;
+  double lat = 1e30, thr = 1e30;
+
+  latency_loop<Op> (d, n / 16);
+  throughput_loop<Op> (d, n / 16);
+
+  for (int round = 0; round < 5; ++round)
+  {
+    const auto t0 = std::chrono::steady_clock::now ();
+    const T x = latency_loop<Op> (d, n);
+    const auto t1 = std::chrono::steady_clock::now ();
+    throughput_loop<Op> (d, n);
+    const auto t2 = std::chrono::steady_clock::now ();
+
+    unsigned char sink;
+    std::memcpy (&sink, &x, 1);
+    bench_sink = sink;
+
+    const double l = std::chrono::duration<double, std::nano> (t1 - t0).count () / n;
+    const double t = std::chrono::duration<double, std::nano> (t2 - t1).count () / (n / array_size * array_size);
+    lat = l < lat ? l : lat;
+    thr = t < thr ? t : thr;
+  }
+
+  report (cfg, type, Op::name (), "latency", lat);
+  report (cfg, type, Op::name (), "throughput", thr);
+}
+
+template <typename Op, typename T>
+static void run_op (bench_config&, const char*, bench_data<T>&, std::false_type)
+{
+}
+
+template <typename T> static void run_type (bench_config& cfg, const char* type)
+{
+  static bench_data<T> d;
+
+  run_op<op_add> (cfg, type, d, typename op_add::template supported<T> ());
+  run_op<op_sub> (cfg, type, d, typename op_sub::template supported<T> ());
+  run_op<op_mul> (cfg, type, d, typename op_mul::template supported<T> ());
+  run_op<op_div> (cfg, type, d, typename op_div::template supported<T> ());
+  run_op<op_mul_int> (cfg, type, d, typename op_mul_int::template supported<T> ());
+  run_op<op_div_int> (cfg, type, d, typename op_div_int::template supported<T> ());
+  run_op<op_neg> (cfg, type, d, typename op_neg::template supported<T> ());
+  run_op<op_less> (cfg, type, d, typename op_less::template supported<T> ());
+  run_op<op_float> (cfg, type, d, typename op_float::template supported<T> ());
+  run_op<op_double> (cfg, type, d, typename op_double::template supported<T> ());
+  run_op<op_int> (cfg, type, d, typename op_int::template supported<T> ());
+  run_op<op_convert> (cfg, type, d, typename op_convert::template supported<T> ());
+}
+
+int main (int argc, char** argv)
+{
+  bench_config cfg = { FORMAT_TEXT, 1 << 22, nullptr, 0 };
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp (argv[i], "--format") == 0 && i + 1 < argc)
+    {
+      ++i;
+      if (std::strcmp (argv[i], "text") == 0)
+	cfg.format = FORMAT_TEXT;
+      else if (std::strcmp (argv[i], "csv") == 0)
+	cfg.format = FORMAT_CSV;
+      else if (std::strcmp (argv[i], "json") == 0)
+	cfg.format = FORMAT_JSON;
+      else
+	goto usage;
+    }
+    else if (std::strcmp (argv[i], "--iterations") == 0 && i + 1 < argc)
+      cfg.iterations = std::strtoul (argv[++i], nullptr, 0);
+    else if (std::strcmp (argv[i], "--filter") == 0 && i + 1 < argc)
+      cfg.filter = argv[++i];
+    else
+      goto usage;
+  }
+
+  if (cfg.iterations < array_size)
+    cfg.iterations = array_size;
+
+  if (cfg.format == FORMAT_TEXT)
+    std::printf ("%-12s %-10s %-10s %8s\n", "type", "op", "mode", "ns/op");
+  else if (cfg.format == FORMAT_CSV)
+    std::printf ("type,op,mode,ns_per_op\n");
+  else
+    std::printf ("[");
+
+  run_type<fxpt_16_16> (cfg, "fxpt_16_16");
+  run_type<fxpt_8_24> (cfg, "fxpt_8_24");
+  run_type<fxpt_9_23> (cfg, "fxpt_9_23");
+  run_type<fxpt_32_32> (cfg, "fxpt_32_32");
+  run_type<fxpt_8_8> (cfg, "fxpt_8_8");
+  run_type<fxpt_4_4> (cfg, "fxpt_4_4");
+  run_type<fxptu_16_16> (cfg, "fxptu_16_16");
+  run_type<float> (cfg, "float");
+  run_type<double> (cfg, "double");
+  run_type<int32_t> (cfg, "int32_t");
+  run_type<int64_t> (cfg, "int64_t");
+
+  if (cfg.format == FORMAT_JSON)
+    std::printf ("\n]\n");
+  return 0;
+
+usage:
+  std::fprintf (stderr, "usage: %s [--format text|csv|json] [--iterations N] [--filter SUBSTRING]\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,212 @@
+#!/bin/sh
+# ------------------------------------------------------------------------------
+#
+# Fixed point C++ template class code generation check
+#
+# Copyright (c) 2012, Oleg Endo
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the copyright holders nor the names of any
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# ------------------------------------------------------------------------------
+#
+# Compiles fixed_point_compile_tests.cpp at -O2, disassembles selected test
+# functions and checks the instruction counts below.  This catches compilers
+# that stop using widening multiplications or start to narrow intermediate
+# results of multiply-accumulate expressions.
+#
+# Usage:
+#   ./fixed_point_codegen_check.sh [-v]
+#
+#   -v	print the disassembly of functions with failed checks
+#
+# The host compiler is taken from CXX (default g++).  If an aarch64 cross
+# compiler is found (AARCH64_CXX, default aarch64-linux-gnu-g++), the aarch64
+# checks are done as well.  Additional compiler options can be passed in
+# CXXFLAGS.  The exit code is non-zero if a check fails.
+#
+# ------------------------------------------------------------------------------
+
+# check tables
+#   function	mnemonic regex		op	count
+#
+# x86-64 has no widening multiply-accumulate, a * b + c * d is two 64 bit
+# imul and an add.  there must be only one narrowing shift at the end.
+
+x86_64_checks='
+test_00_1	imul			==	1
+test_00_1	sar			==	1
+test_03		imul			==	2
+test_03		sar			==	1
+test_03		i?div			==	0
+test_17_3	imul			==	1
+test_17_4	imul			==	1
+test_28		imul			==	1
+test_28		i?div			==	0
+test_31		idiv			==	1
+test_32		i?div			==	0
+test_35		imul			==	3
+test_36		imul			==	3
+test_38		imul			==	1
+test_38		sar			==	1
+test_39		imul			==	1
+test_39		sar			==	1
+test_07		j.*			==	0
+'
+
+# aarch64 has widening multiply (smull) and multiply-accumulate (smaddl).
+# a 64 bit mul / madd would mean the operands are sign extended first.
+
+aarch64_checks='
+test_00_1	smull			==	1
+test_00_1	s?div			==	0
+test_03		smull			==	1
+test_03		smaddl			==	1
+test_03		(mul|madd)		==	0
+test_03		sdiv			==	0
+test_28		smull			==	1
+test_32		sdiv			==	0
+test_38		smull			==	1
+test_07		b\..*			==	0
+'
+
+# functions in the tables must not call anything.
+no_call='call|bl|blr'
+
+verbose=0
+[ "$1" = "-v" ] && verbose=1
+
+src_dir=$(cd "$(dirname "$0")" && pwd)
+tmp_dir=$(mktemp -d)
+trap 'rm -rf "$tmp_dir"' EXIT
+
+failed=0
+checked=0
+
+# disassemble function $2 from the objdump output file $1, print mnemonics.
+mnemonics ()
+{
+  awk -v fn="<$2(" '
+    index ($0, fn) { found = 1; next }
+    found && /^$/ { exit }
+    found { split ($0, f, "\t"); if (f[2] != "") { split (f[2], m, " "); print m[1] } }
+  ' "$1"
+}
+
+disassembly ()
+{
+  awk -v fn="<$2(" '
+    index ($0, fn) { found = 1 }
+    found && /^$/ { exit }
+    found { print }
+  ' "$1"
+}
+
+# run_checks <arch> <compiler> <objdump> <table>
+run_checks ()
+{
+  arch=$1
+  obj="$tmp_dir/$arch.o"
+  dis="$tmp_dir/$arch.dis"
+
+  if ! $2 -std=c++11 -O2 $CXXFLAGS -c "$src_dir/fixed_point_compile_tests.cpp" -o "$obj"; then
+    echo "$arch: compilation failed"
+    failed=$((failed + 1))
+    return
+  fi
+  $3 -d -C --no-show-raw-insn "$obj" > "$dis"
+
+  echo "$arch: $($2 --version | head -n 1)"
+
+  funcs=$(echo "$4" | awk 'NF { print $1 }' | sort -u)
+  bad_funcs=""
+
+  while read -r fn re op count; do
+    [ -z "$fn" ] && continue
+
+    if ! grep -q "<$fn(" "$dis"; then
+      echo "  FAIL $fn: function not found"
+      failed=$((failed + 1))
+      continue
+    fi
+
+    n=$(mnemonics "$dis" "$fn" | grep -c -E "^($re)\$")
+    checked=$((checked + 1))
+    if [ "$n" "$(test_op "$op")" "$count" ]; then
+      echo "  ok   $fn: $re $op $count"
+    else
+      echo "  FAIL $fn: $re $op $count, got $n"
+      failed=$((failed + 1))
+      bad_funcs="$bad_funcs $fn"
+    fi
+  done <<EOF
+$4
+$(for fn in $funcs; do printf '%s\t%s\t==\t0\n' "$fn" "$no_call"; done)
+EOF
+
+  if [ $verbose -eq 1 ]; then
+    for fn in $(echo $bad_funcs | tr ' ' '\n' | sort -u); do
+      disassembly "$dis" "$fn"
+      echo
+    done
+  fi
+}
+
+test_op ()
+{
+  case $1 in
+    "==") echo "-eq" ;;
+    "<=") echo "-le" ;;
+    ">=") echo "-ge" ;;
+    *) echo "-eq" ;;
+  esac
+}
+
+host_cxx=${CXX:-g++}
+if ! command -v "$host_cxx" > /dev/null 2>&1; then
+  echo "$host_cxx not found"
+  exit 1
+fi
+
+case $($host_cxx -dumpmachine) in
+  x86_64*)
+    run_checks x86_64 "$host_cxx" "${OBJDUMP:-objdump}" "$x86_64_checks" ;;
+  aarch64*)
+    run_checks aarch64 "$host_cxx" "${OBJDUMP:-objdump}" "$aarch64_checks" ;;
+  *)
+    echo "$($host_cxx -dumpmachine): no checks for the host" ;;
+esac
+
+cross_cxx=${AARCH64_CXX:-aarch64-linux-gnu-g++}
+cross_objdump=${AARCH64_OBJDUMP:-aarch64-linux-gnu-objdump}
+if [ "$($host_cxx -dumpmachine | cut -d- -f1)" != aarch64 ]; then
+  if command -v "$cross_cxx" > /dev/null 2>&1 && command -v "$cross_objdump" > /dev/null 2>&1; then
+    run_checks aarch64 "$cross_cxx" "$cross_objdump" "$aarch64_checks"
+  else
+    echo "aarch64: $cross_cxx not found, skipped"
+  fi
+fi
+
+echo "$checked checks, $failed failed"
+[ $checked -gt 0 ] && [ $failed -eq 0 ]
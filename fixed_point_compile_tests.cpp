@@ -34,6 +34,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 Example how to compile this file:
   g++ -std=c++11 -O2 fixed_point_compile_tests.cpp
 
+The instructions generated for some of the test functions are checked by
+fixed_point_codegen_check.sh.  Renaming or changing those functions requires
+updating the check tables in the script.
+
 --------------------------------------------------------------------------------
 */
 
@@ -0,0 +1,330 @@
+/*
+--------------------------------------------------------------------------------
+
+Fixed point math function accuracy and throughput harness
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 fixed_point_math_bench.cpp
+
+Usage:
+  ./a.out [--samples N] [--budget EPS]
+
+For each fixed point format, every implementation variant of a function is
+evaluated over the inputs of the format: all representable values for
+formats of up to 16 bits, N pseudo random raw values (default 2^20) for
+wider formats.  The errors are measured against a long double reference and
+reported in units of numeric_limits<T>::epsilon (), i.e. the weight of the
+least significant bit.  A correctly rounded result has an error of at most
+0.5.  The time per call is measured over the same inputs.
+
+With --budget the fastest variant whose maximum error is within the budget
+is marked for each format.
+
+fixed_point.hpp does not provide math functions yet.  The variants below are
+candidate sin implementations that work on the raw values:
+
+  - double:	conversion to double, std::sin, conversion back.
+  - table:	1024 entry table with linear interpolation.
+  - poly:	quadrant folding and a degree 9 odd polynomial.
+  - cordic:	28 CORDIC rotations.
+
+All variants share the argument reduction, which multiplies the raw value
+with a 128-bit constant 1 / (2 pi) and yields the phase in Q32 turns.
+The variants compute sin in Q30 and round to the output format.
+
+--------------------------------------------------------------------------------
+*/
+
+#include "fixed_point.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef fixed_point<int8_t, 4, 4> fxpt_4_4;
+typedef fixed_point<int16_t, 8, 8> fxpt_8_8;
+typedef fixed_point<int16_t, 4, 12> fxpt_4_12;
+typedef fixed_point<int32_t, 16, 16> fxpt_16_16;
+typedef fixed_point<int32_t, 8, 24> fxpt_8_24;
+typedef fixed_point<int64_t, 32, 32> fxpt_32_32;
+
+#define BENCH_NOINLINE __attribute__ ((noinline))
+
+// ---------------------------------------------------------------------------
+// shared helpers of the variants.
+
+// floor (2^128 / (2 pi)), split into two 64-bit halves.
+static const uint64_t fxm_inv_2pi_hi = 0x28be60db9391054aull;
+static const uint64_t fxm_inv_2pi_lo = 0x7f09d5f47d4d3770ull;
+
+// x mod 2 pi as a fraction of a turn, Q32.
+template <typename T> inline uint32_t fxm_phase (const T& x)
+{
+  const __int128 raw = x.raw ();
+  const __int128 p = raw * (__int128)fxm_inv_2pi_hi
+		     + ((raw * (__int128)fxm_inv_2pi_lo) >> 64);
+  return static_cast<uint32_t> (p >> (T::fractional_bits + 32));
+}
+
+// Q30 value to the format, rounded to nearest.
+template <typename T> inline T fxm_from_q30 (int64_t v)
+{
+  typedef typename T::raw_type raw_type;
+  const unsigned f = T::fractional_bits;
+  return T (static_cast<raw_type> (f >= 30 ? v << ((f - 30) & 63)
+					   : (v + (int64_t (1) << (29 - f))) >> (30 - f)),
+	    FIXED_POINT_RAW);
+}
+
+// ---------------------------------------------------------------------------
+// sin variants.
+
+template <typename T> inline T sin_double (const T& x)
+{
+  return T (std::sin (static_cast<double> (x)));
+}
+
+struct fxm_sin_table_data
+{
+  int32_t v[1025];
+
+  fxm_sin_table_data (void)
+  {
+    for (int i = 0; i <= 1024; ++i)
+      v[i] = static_cast<int32_t> (std::llround (std::sin (2 * 3.14159265358979323846L * i / 1024) * (1 << 30)));
+  }
+};
+
+static const fxm_sin_table_data fxm_sin_table;
+
+template <typename T> inline T sin_table (const T& x)
+{
+  const uint32_t ph = fxm_phase (x);
+  const uint32_t i = ph >> 22;
+  const int64_t frac = ph & ((1u << 22) - 1);
+  const int64_t a = fxm_sin_table.v[i];
+  const int64_t b = fxm_sin_table.v[i + 1];
+  return fxm_from_q30<T> (a + (((b - a) * frac) >> 22));
+}
+
+template <typename T> inline T sin_poly (const T& x)
+{
+  // near-minimax coefficients of sin (pi/2 z) for z in [0, 1], Q30.
+  const int64_t c1 = 1686629674, c3 = -693597876, c5 = 85564855, c7 = -5016767, c9 = 161943;
+
+  const uint32_t ph = fxm_phase (x);
+  const uint32_t quadrant = ph >> 30;
+  int64_t z = ph & ((1u << 30) - 1);
+  if (quadrant & 1)
+    z = (int64_t (1) << 30) - z;
+
+  const int64_t z2 = (z * z) >> 30;
+  int64_t p = c9;
+  p = c7 + ((p * z2) >> 30);
+  p = c5 + ((p * z2) >> 30);
+  p = c3 + ((p * z2) >> 30);
+  p = c1 + ((p * z2) >> 30);
+  const int64_t s = (p * z) >> 30;
+  return fxm_from_q30<T> (quadrant & 2 ? -s : s);
+}
+
+struct fxm_cordic_data
+{
+  static const int iterations = 28;
+  int64_t atan_q32[iterations];		// atan (2^-i) in Q32 turns
+  int64_t gain_q30;
+
+  fxm_cordic_data (void)
+  {
+    long double k = 1;
+    for (int i = 0; i < iterations; ++i)
+    {
+      atan_q32[i] = std::llround (std::atan (std::ldexp (1.0L, -i)) / (2 * 3.14159265358979323846L) * 4294967296.0L);
+      k /= std::sqrt (1 + std::ldexp (1.0L, -2 * i));
+    }
+    gain_q30 = std::llround (k * (1 << 30));
+  }
+};
+
+static const fxm_cordic_data fxm_cordic;
+
+template <typename T> inline T sin_cordic (const T& x)
+{
+  // angle in [-1/2, 1/2) turns, folded into [-1/4, 1/4].
+  int64_t z = static_cast<int32_t> (fxm_phase (x));
+  if (z > (int64_t (1) << 30))
+    z = (int64_t (1) << 31) - z;
+  else if (z < -(int64_t (1) << 30))
+    z = -(int64_t (1) << 31) - z;
+
+  int64_t cx = fxm_cordic.gain_q30, cy = 0;
+  for (int i = 0; i < fxm_cordic_data::iterations; ++i)
+  {
+    // branch-free rotation direction, d = 0 for z >= 0 and -1 otherwise.
+    const int64_t d = z >> 63;
+    const int64_t dx = cy >> i, dy = cx >> i;
+    cx -= (dx ^ d) - d;
+    cy += (dy ^ d) - d;
+    z -= (fxm_cordic.atan_q32[i] ^ d) - d;
+  }
+  return fxm_from_q30<T> (cy);
+}
+
+// ---------------------------------------------------------------------------
+// harness.
+
+struct variant_result
+{
+  const char* name;
+  double max_err;
+  double rms_err;
+  double ns;
+};
+
+template <typename T> static std::vector<T> make_inputs (std::size_t samples)
+{
+  typedef typename T::raw_type raw_type;
+  std::vector<T> in;
+
+  if (sizeof (raw_type) <= 2)
+  {
+    for (int64_t r = std::numeric_limits<raw_type>::min (); r <= std::numeric_limits<raw_type>::max (); ++r)
+      in.push_back (T (static_cast<raw_type> (r), FIXED_POINT_RAW));
+    return in;
+  }
+
+  uint64_t s = 0x9E3779B97F4A7C15ull;
+  for (std::size_t i = 0; i < samples; ++i)
+  {
+    // xorshift, uniform over the raw values.
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    in.push_back (T (static_cast<raw_type> (s), FIXED_POINT_RAW));
+  }
+  return in;
+}
+
+static volatile int64_t bench_sink;
+
+template <typename T, T (*F) (const T&)>
+BENCH_NOINLINE int64_t run_variant (const T* in, std::size_t n)
+{
+  int64_t sum = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    sum += F (in[i]).raw ();
+  return sum;
+}
+
+template <typename T, T (*F) (const T&)>
+static variant_result evaluate (const char* name, const std::vector<T>& in)
+{
+  const long double eps = std::ldexp (1.0L, -int (T::fractional_bits));
+  long double max_err = 0, sum_sq = 0;
+
+  for (const T& x : in)
+  {
+    const long double ref = std::sin (std::ldexp (static_cast<long double> (x.raw ()), -int (T::fractional_bits)));
+    const long double got = std::ldexp (static_cast<long double> (F (x).raw ()), -int (T::fractional_bits));
+    const long double err = std::fabs (got - ref) / eps;
+    max_err = err > max_err ? err : max_err;
+    sum_sq += err * err;
+  }
+
+  double ns = 1e30;
+  for (int round = 0; round < 5; ++round)
+  {
+    const auto t0 = std::chrono::steady_clock::now ();
+    bench_sink = run_variant<T, F> (in.data (), in.size ());
+    const auto t1 = std::chrono::steady_clock::now ();
+    const double t = std::chrono::duration<double, std::nano> (t1 - t0).count () / in.size ();
+    ns = t < ns ? t : ns;
+  }
+
+  const variant_result r = { name, double (max_err), double (std::sqrt (sum_sq / in.size ())), ns };
+  return r;
+}
+
+template <typename T> static void run_format (const char* format, std::size_t samples, double budget)
+{
+  const std::vector<T> in = make_inputs<T> (samples);
+
+  const variant_result res[] =
+  {
+    evaluate<T, sin_double<T>> ("double", in),
+    evaluate<T, sin_table<T>> ("table", in),
+    evaluate<T, sin_poly<T>> ("poly", in),
+    evaluate<T, sin_cordic<T>> ("cordic", in)
+  };
+
+  const std::size_t count = sizeof (res) / sizeof (res[0]);
+  std::size_t pick = count;
+  for (std::size_t i = 0; i < count; ++i)
+    if (budget > 0 && res[i].max_err <= budget && (pick == count || res[i].ns < res[pick].ns))
+      pick = i;
+
+  std::printf ("\nsin, %s, %s %zu inputs\n", format, sizeof (typename T::raw_type) <= 2 ? "all" : "sampled", in.size ());
+  std::printf ("  %-8s %12s %12s %10s\n", "variant", "max err", "rms err", "ns/call");
+  for (std::size_t i = 0; i < count; ++i)
+    std::printf ("  %-8s %12.3f %12.3f %10.2f%s\n", res[i].name, res[i].max_err, res[i].rms_err, res[i].ns,
+		 i == pick ? "  <- fastest within budget" : "");
+}
+
+int main (int argc, char** argv)
+{
+  std::size_t samples = 1 << 20;
+  double budget = 0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp (argv[i], "--samples") == 0 && i + 1 < argc)
+      samples = std::strtoul (argv[++i], nullptr, 0);
+    else if (std::strcmp (argv[i], "--budget") == 0 && i + 1 < argc)
+      budget = std::strtod (argv[++i], nullptr);
+    else
+    {
+      std::fprintf (stderr, "usage: %s [--samples N] [--budget EPS]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::printf ("errors in units of epsilon of the format");
+
+  run_format<fxpt_4_4> ("fxpt_4_4", samples, budget);
+  run_format<fxpt_8_8> ("fxpt_8_8", samples, budget);
+  run_format<fxpt_4_12> ("fxpt_4_12", samples, budget);
+  run_format<fxpt_16_16> ("fxpt_16_16", samples, budget);
+  run_format<fxpt_8_24> ("fxpt_8_24", samples, budget);
+  run_format<fxpt_32_32> ("fxpt_32_32", samples, budget);
+  return 0;
+}
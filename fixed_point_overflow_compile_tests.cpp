@@ -0,0 +1,219 @@
+/*
+--------------------------------------------------------------------------------
+
+Fixed point C++ template class overflow counter tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 -pthread fixed_point_overflow_compile_tests.cpp
+
+The resulting executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+#define __FIXED_POINT_ENABLE_OVERFLOW_COUNTERS__
+#include "fixed_point.hpp"
+
+#include <thread>
+#include <vector>
+#include <cstring>
+
+typedef fixed_point<int32_t, 16, 16> fxpt_16_16;
+typedef fixed_point<int16_t, 8, 8> fxpt_8_8;
+typedef fixed_point<int8_t, 4, 4> fxpt_4_4;
+typedef fixed_point<uint32_t, 16, 16> fxptu_16_16;
+typedef fixed_point<int64_t, 32, 32, true> fxpt_32_32w;
+
+typedef fixed_point_overflow_counters counters;
+
+// add + jo, the counting is out of line.
+fxpt_16_16 test_00 (fxpt_16_16 a, fxpt_16_16 b)
+{
+  return a + b;
+}
+
+fxpt_16_16 test_01 (fxpt_16_16 a, fxpt_16_16 b, fxpt_16_16 c, fxpt_16_16 d)
+{
+  return a * b + c * d;
+}
+
+// constant evaluation is not affected.
+constexpr fxpt_16_16 const_sum = fxpt_16_16 (1) + fxpt_16_16 (2);
+static_assert (const_sum.raw () == 0x30000, "constant evaluation failed");
+
+static bool check_ops (void)
+{
+  counters::reset ();
+
+  volatile int big = 100;
+  const fxpt_8_8 a = big;
+  fxpt_8_8 x = a + a;				// add
+  x = -a - a - a;				// sub
+  x -= a;					// sub
+  if (counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_ADD) != 1
+      || counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_SUB) != 2)
+    return false;
+
+  // no events for results in range.
+  x = a + fxpt_8_8 (20) - a;
+  if (counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_ADD) != 1
+      || counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_SUB) != 2)
+    return false;
+
+  const fxptu_16_16 u = 1;
+  const fxptu_16_16 v = u - fxptu_16_16 (2);
+  if (counters::count<fxptu_16_16> (FIXED_POINT_OVERFLOW_SUB) != 1)
+    return false;
+
+  return (int)x == 20 && v.raw () == 0xFFFF0000;
+}
+
+static bool check_narrowing (void)
+{
+  counters::reset ();
+
+  volatile double d = 300.0;
+  const fxpt_16_16 a = d;
+
+  // the product fits into the widened type, narrowing does not.
+  fxpt_16_16 p = a * a;
+  p *= a;
+  if (counters::count<fxpt_16_16> (FIXED_POINT_OVERFLOW_MUL) != 2
+      || counters::count<fxpt_32_32w> (FIXED_POINT_OVERFLOW_ADD) != 0)
+    return false;
+
+  // a / 0.001 does not fit.
+  const fxpt_16_16 q = a / fxpt_16_16 (0.001);
+  if (counters::count<fxpt_16_16> (FIXED_POINT_OVERFLOW_DIV) != 1)
+    return false;
+
+  // 300 does not fit into 8.8, 3 does into 8.8, but not into 4.4.
+  const fxpt_8_8 b = (fxpt_8_8)a;
+  const fxpt_8_8 c = (fxpt_8_8)fxpt_16_16 (3);
+  const fxpt_4_4 e = (fxpt_4_4)(fxpt_8_8)fxpt_16_16 (20);
+  if (counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_CONVERT) != 1
+      || counters::count<fxpt_4_4> (FIXED_POINT_OVERFLOW_CONVERT) != 1
+      || (int)c != 3)
+    return false;
+
+  return p.raw () != 0 && q.raw () != 0 && b.raw () != 0 && e.raw () != 0;
+}
+
+static bool check_from_float (void)
+{
+  counters::reset ();
+
+  volatile double big = 40000.0;
+  volatile float small = -32768.0f;
+  volatile double nan = std::numeric_limits<double>::quiet_NaN ();
+
+  const fxpt_16_16 a = big;
+  const fxpt_16_16 b = small;			// exactly the minimum
+  const fxpt_16_16 c = nan;
+  const fxptu_16_16 d = -(double)big;
+  const fxptu_16_16 e = -1.0 / 131072;		// half an epsilon, truncated to 0
+
+  return counters::count<fxpt_16_16> (FIXED_POINT_OVERFLOW_FROM_FLOAT) == 2
+	 && counters::count<fxptu_16_16> (FIXED_POINT_OVERFLOW_FROM_FLOAT) == 1
+	 && (int)b == -32768 && e.raw () == 0 && a.raw () + c.raw () + d.raw () != 1;
+}
+
+static volatile int16_t thread_sink;
+
+static bool check_threads (void)
+{
+  counters::reset ();
+
+  // more threads than slots, the remaining ones share the last slot.  a
+  // thread releases its slot when it exits, thus all threads are kept alive
+  // until every thread has counted.
+  const unsigned thread_count = counters::max_threads + 8;
+  const unsigned n = 1000;
+  std::vector<std::thread> threads;
+  unsigned counted = 0;
+
+  for (unsigned t = 0; t < thread_count; ++t)
+    threads.emplace_back ([n, thread_count, &counted] (void)
+    {
+      volatile int16_t r = 0x7F00;
+      for (unsigned i = 0; i < n; ++i)
+      {
+	const fxpt_8_8 x (int16_t (r), FIXED_POINT_RAW);
+	thread_sink = (x + x).raw ();
+      }
+
+      __atomic_add_fetch (&counted, 1, __ATOMIC_ACQ_REL);
+      while (__atomic_load_n (&counted, __ATOMIC_ACQUIRE) != thread_count)
+	std::this_thread::yield ();
+    });
+
+  for (auto& t : threads)
+    t.join ();
+
+  return counters::count<fxpt_8_8> (FIXED_POINT_OVERFLOW_ADD) == thread_count * n;
+}
+
+static bool check_metrics (void)
+{
+  counters::reset ();
+
+  volatile int big = 100;
+  const fxpt_8_8 a = big;
+  const fxpt_8_8 b = a + a;
+
+  std::FILE* f = std::tmpfile ();
+  counters::write_metrics (f);
+  std::rewind (f);
+
+  char buf[1024];
+  const std::size_t len = std::fread (buf, 1, sizeof (buf) - 1, f);
+  std::fclose (f);
+  buf[len] = '\0';
+
+  return b.raw () != 0
+	 && std::strstr (buf, "# TYPE fixed_point_overflow_total counter\n") == buf
+	 && std::strstr (buf, "fixed_point_overflow_total{format=\"s8.8\",op=\"add\"} 1\n") != nullptr
+	 && std::strstr (buf, "op=\"sub\"") == nullptr;
+}
+
+int main (void)
+{
+  if (!check_ops ())
+    return 1;
+  if (!check_narrowing ())
+    return 2;
+  if (!check_from_float ())
+    return 3;
+  if (!check_threads ())
+    return 4;
+  if (!check_metrics ())
+    return 5;
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*
+--------------------------------------------------------------------------------
+
+Fixed point C++ template class shadow precision tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 fixed_point_shadow_compile_tests.cpp
+
+The shadow values are compared against the same operations done in double
+precision.  The resulting executable returns a non-zero exit code if a test
+fails.
+
+--------------------------------------------------------------------------------
+*/
+
+#define __FIXED_POINT_ENABLE_SHADOW__
+#include "fixed_point.hpp"
+
+typedef fixed_point<int32_t, 16, 16> fxpt_16_16;
+typedef fixed_point<int32_t, 8, 24> fxpt_8_24;
+typedef fixed_point<int16_t, 8, 8> fxpt_8_8;
+typedef fixed_point<int64_t, 32, 32, true> fxpt_32_32w;
+
+static_assert (sizeof (fxpt_16_16) > sizeof (int32_t), "shadow value missing");
+
+fxpt_16_16 test_00 (fxpt_16_16 a, fxpt_16_16 b, fxpt_16_16 c)
+{
+  return FIXED_POINT_SHADOW_CHECK (a * b + c);
+}
+
+double test_01 (fxpt_16_16 a)
+{
+  return a.shadow ();
+}
+
+static bool check_ops (void)
+{
+  const fxpt_16_16 a = 0.1;
+  const fxpt_16_16 b = 3.3;
+  const int n = 7;
+
+  // the shadow of a converted value is the unquantized value.
+  if (a.shadow () != 0.1 || (double)a == 0.1)
+    return false;
+
+  if ((a + b).shadow () != 0.1 + 3.3
+      || (a - b).shadow () != 0.1 - 3.3
+      || (-a).shadow () != -0.1
+      || (a / b).shadow () != 0.1 / 3.3
+      || (a / n).shadow () != 0.1 / n)
+    return false;
+
+  // multiplication results in the widened type.
+  const fxpt_32_32w p = a * b;
+  if (p.shadow () != 0.1 * 3.3 || (a * n).shadow () != 0.1 * n)
+    return false;
+
+  fxpt_16_16 x = a;
+  x += b;
+  x -= a;
+  x *= b;
+  x /= b;
+  ++x;
+  x--;
+  if (x.shadow () != (0.1 + 3.3 - 0.1) * 3.3 / 3.3 + 1 - 1)
+    return false;
+
+  return std::min (a, b).shadow () == 0.1 && std::max (a, b).shadow () == 3.3
+	 && std::trunc (b).shadow () == 3;
+}
+
+static bool check_convert (void)
+{
+  const fxpt_8_24 a = 1.0 / 3;
+
+  // narrowing and widening conversions and convert_to keep the shadow.
+  const fxpt_16_16 b = (fxpt_16_16)a;
+  const fxpt_32_32w c = b;
+  const fxpt_8_8 d = (fxpt_8_8)b;
+  if (b.shadow () != 1.0 / 3 || c.shadow () != 1.0 / 3 || d.shadow () != 1.0 / 3
+      || a.convert_to<int16_t, 8, 8> ().shadow () != 1.0 / 3)
+    return false;
+
+  // a raw value without a shadow is exact.
+  const fxpt_16_16 e (0x18000, FIXED_POINT_RAW);
+  const fxpt_16_16 f (0x18000, FIXED_POINT_RAW, 1.4);
+  return e.shadow () == 1.5 && f.shadow () == 1.4;
+}
+
+static fxpt_8_8 sum_tenths (int n)
+{
+  fxpt_8_8 s = 0;
+  for (int i = 0; i < n; ++i)
+    s = FIXED_POINT_SHADOW_CHECK (s + fxpt_8_8 (0.1));
+  return s;
+}
+
+static bool check_registry (void)
+{
+  fixed_point_shadow_registry::clear ();
+
+  const fxpt_16_16 exact = FIXED_POINT_SHADOW_CHECK (fxpt_16_16 (2) * fxpt_16_16 (0.5));
+  const fxpt_8_8 s = sum_tenths (100);
+
+  if (fixed_point_shadow_registry::size () != 2 || (double)exact != 1)
+    return false;
+
+  const fixed_point_shadow_entry e0 = fixed_point_shadow_registry::entry (0);
+  const fixed_point_shadow_entry e1 = fixed_point_shadow_registry::entry (1);
+  if (e0.count != 1 || e0.max_error != 0 || e1.count != 100)
+    return false;
+
+  // 0.1 is 25/256 in 8.8 format, which loses 0.1 - 25/256 per addition.
+  const double err = 100 * (0.1 - 25.0 / 256);
+  if (std::fabs (e1.max_error - err) > 1e-9 || std::fabs (e1.max_error_eps - err * 256) > 1e-6
+      || e1.value != (double)s || e1.line == e0.line)
+    return false;
+
+  const fixed_point_shadow_entry w = fixed_point_shadow_registry::worst ();
+  return w.line == e1.line && std::strcmp (w.file, __FILE__) == 0
+	 && fixed_point_shadow_registry::dropped () == 0;
+}
+
+static bool check_full (void)
+{
+  fixed_point_shadow_registry::clear ();
+
+  // locations beyond the capacity are counted as dropped.
+  for (std::size_t i = 0; i < fixed_point_shadow_registry::capacity + 3; ++i)
+    fixed_point_shadow_registry::record (__FILE__, i, 1, 1, 1);
+
+  return fixed_point_shadow_registry::size () == fixed_point_shadow_registry::capacity
+	 && fixed_point_shadow_registry::dropped () == 3;
+}
+
+int main (void)
+{
+  if (!check_ops ())
+    return 1;
+  if (!check_convert ())
+    return 2;
+  if (!check_registry ())
+    return 3;
+  if (!check_full ())
+    return 4;
+  return 0;
+}
@@ -0,0 +1,284 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware counter clock C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The hardware counter clock is a std::chrono clock on top of a free-running
+hardware counter register, e.g. a 64-bit timer that is exposed as two
+32-bit registers.  Reading the time does not need a system call and costs
+only the register reads and a few multiplications:
+
+  typedef hw_counter_split_source<hw_reg_r<uint32_t, const_addr<0xA0000104>>,
+				  hw_reg_r<uint32_t, const_addr<0xA0000100>>> timer_source;
+
+  typedef hw_counter_clock<timer_source, 25000000> timer_clock;	// 25 MHz
+
+  auto t0 = timer_clock::now ();
+  ...
+  auto elapsed = timer_clock::now () - t0;
+
+The counter sources are:
+
+  - hw_counter_source<Reg>: a single register, e.g. a 64-bit counter.
+  - hw_counter_split_source<HiReg, LoReg>: a 64-bit counter that is split
+    into high and low registers.  the read sequence is hi, lo, hi, which
+    detects a carry from the low into the high part between the reads.
+  - hw_counter_mapped_split_source<Reg>: the same for registers in a register
+    block that is mapped at run time.  the registers must be attached before
+    the clock is used.
+  - hw_counter_tsc_source: the x86 time stamp counter, e.g. for testing the
+    clock users without the hardware.
+
+The tick to nanosecond conversion factor is a fixed_point<uint64_t, 32, 32>
+number.  If the counter frequency is given as a template argument, the factor
+is computed at compile time.  Otherwise the frequency must be set at run time
+with set_frequency or calibrate.  The conversion itself is a split 64 x 64
+bit multiplication without any division.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_COUNTER_CLOCK_HEADER_INCLUDED__
+#define __HWREG_COUNTER_CLOCK_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <chrono>
+#include <ratio>
+#include <type_traits>
+
+#if defined (__i386__) || defined (__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "fixed_point.hpp"
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+#ifndef __FIXED_POINT_USE_NAMESPACE__
+#define __FIXED_POINT_USE_NAMESPACE__
+#define __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+// counter in a single constant address register.
+template <typename Reg> struct hw_counter_source
+{
+  static_assert (std::is_integral<typename Reg::base_type>::value && Reg::readable
+		 , "hw_counter_source register must be a readable integral register");
+
+  static uint64_t read (void) { return static_cast<uint64_t> (Reg ().read ()); }
+};
+
+// 64-bit counter in two constant address 32-bit registers.
+template <typename HiReg, typename LoReg> struct hw_counter_split_source
+{
+  static_assert (sizeof (typename HiReg::base_type) == 4 && sizeof (typename LoReg::base_type) == 4
+		 , "hw_counter_split_source registers must be 32-bit registers");
+
+  static uint64_t read (void)
+  {
+    const HiReg hi_reg;
+    const LoReg lo_reg;
+
+    const uint32_t hi = hi_reg.read ();
+    uint32_t lo = lo_reg.read ();
+    const uint32_t hi2 = hi_reg.read ();
+
+    // the low part wrapped around between the reads.  the second high value
+    // belongs to the new epoch, read the low part again.
+    if (__builtin_expect (hi != hi2, 0))
+      lo = lo_reg.read ();
+
+    return (uint64_t (hi2) << 32) | lo;
+  }
+};
+
+// 64-bit counter in two 32-bit registers of a run time mapped register block.
+// Tag distinguishes multiple counters with the same register type.
+template <typename Reg, typename Tag = void> struct hw_counter_mapped_split_source
+{
+  static_assert (sizeof (typename Reg::base_type) == 4
+		 , "hw_counter_mapped_split_source registers must be 32-bit registers");
+
+  static void attach (const Reg& hi, const Reg& lo) noexcept
+  {
+    __hi = &hi;
+    __lo = &lo;
+  }
+
+  static uint64_t read (void)
+  {
+    const uint32_t hi = __hi->read ();
+    uint32_t lo = __lo->read ();
+    const uint32_t hi2 = __hi->read ();
+
+    if (__builtin_expect (hi != hi2, 0))
+      lo = __lo->read ();
+
+    return (uint64_t (hi2) << 32) | lo;
+  }
+
+private:
+  static const Reg* __hi;
+  static const Reg* __lo;
+};
+
+template <typename Reg, typename Tag> const Reg* hw_counter_mapped_split_source<Reg, Tag>::__hi;
+template <typename Reg, typename Tag> const Reg* hw_counter_mapped_split_source<Reg, Tag>::__lo;
+
+#if defined (__i386__) || defined (__x86_64__)
+// time stamp counter.  the frequency is usually not known and has to be
+// calibrated.
+struct hw_counter_tsc_source
+{
+  static uint64_t read (void) noexcept { return __rdtsc (); }
+};
+#endif
+
+// Hz = 0 means that the frequency is set at run time.
+template <typename Source, uint64_t Hz = 0> class hw_counter_clock
+{
+public:
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<hw_counter_clock> time_point;
+
+  static constexpr bool is_steady = true;
+
+  // nanoseconds per tick.
+  typedef __FIXED_POINT_USE_NAMESPACE__ fixed_point<uint64_t, 32, 32> factor_type;
+
+  static time_point now (void)
+  {
+    return time_point (to_duration (Source::read ()));
+  }
+
+  static uint64_t ticks (void) { return Source::read (); }
+
+  static duration to_duration (uint64_t ticks) noexcept
+  {
+    return duration (static_cast<rep> (mul_factor (ticks, factor ().raw ())));
+  }
+
+  static factor_type factor (void) noexcept
+  {
+    return Hz != 0 ? factor_type (factor_raw (Hz), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW)
+		   : factor_type (__factor, __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  }
+
+  static void set_frequency (uint64_t hz) noexcept
+  {
+    static_assert (Hz == 0, "hw_counter_clock frequency is a template argument");
+    __factor = factor_raw (hz);
+  }
+
+  // measure the counter frequency against std::chrono::steady_clock.
+  // returns the frequency in Hz, or 0 if the counter did not advance during
+  // the interval, e.g. a stopped counter or a coarse counter and a short
+  // interval.  the frequency is not changed in that case.
+  static uint64_t calibrate (std::chrono::milliseconds interval = std::chrono::milliseconds (20))
+  {
+    typedef std::chrono::steady_clock ref;
+
+    const ref::time_point r0 = ref::now ();
+    const uint64_t t0 = Source::read ();
+    while (ref::now () - r0 < interval)
+      ;
+    const uint64_t t1 = Source::read ();
+    const ref::time_point r1 = ref::now ();
+
+    const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds> (r1 - r0).count ();
+    const uint64_t hz = ns != 0 ? static_cast<uint64_t> ((t1 - t0) * 1e9 / ns) : 0;
+    if (hz != 0)
+      set_frequency (hz);
+    return hz;
+  }
+
+private:
+  // the division is done when the frequency is set, not per conversion.
+  static constexpr uint64_t factor_raw (uint64_t hz) noexcept
+  {
+    return ((uint64_t (1000000000) << 32) + hz / 2) / hz;
+  }
+
+  // ticks * factor >> 32, rounded to nearest, with 64-bit multiplications
+  // only.  the factor is split into its integral and fractional part, the
+  // ticks into their high and low 32 bits.  only the last partial product
+  // has fractional bits.
+  static constexpr uint64_t mul_factor (uint64_t t, uint64_t f) noexcept
+  {
+    return t * (f >> 32)
+	   + (t >> 32) * (f & 0xFFFFFFFF)
+	   + (((t & 0xFFFFFFFF) * (f & 0xFFFFFFFF) + 0x80000000) >> 32);
+  }
+
+  static uint64_t __factor;
+};
+
+template <typename Source, uint64_t Hz> uint64_t hw_counter_clock<Source, Hz>::__factor;
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#undef __FIXED_POINT_USE_NAMESPACE__
+#undef __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#endif
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_COUNTER_CLOCK_HEADER_INCLUDED__
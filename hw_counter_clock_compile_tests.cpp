@@ -0,0 +1,213 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware counter clock tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_counter_clock_compile_tests.cpp
+
+The counter registers are simulated by register types whose reads advance a
+counter value, so that a carry from the low into the high part can be forced
+between two reads.  The resulting executable returns a non-zero exit code if
+a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_counter_clock.hpp"
+
+using namespace test_namespace;
+
+typedef hw_counter_split_source<hw_reg_r<uint32_t, const_addr<0xA0000104>>,
+				hw_reg_r<uint32_t, const_addr<0xA0000100>>> timer_source;
+
+typedef hw_counter_clock<timer_source, 25000000> timer_clock;	// 40 ns per tick
+typedef hw_counter_clock<timer_source, 3000000> slow_clock;	// 333.33 ns per tick
+typedef hw_counter_clock<timer_source> runtime_clock;
+
+static_assert (timer_clock::is_steady, "hw_counter_clock must be steady");
+static_assert (std::is_same<timer_clock::duration, std::chrono::nanoseconds>::value
+	       , "unexpected hw_counter_clock duration");
+
+// hi, lo, hi and a predicted not taken branch for the lo re-read.
+uint64_t test_00 (void)
+{
+  return timer_source::read ();
+}
+
+// register reads and three multiplications, no division.
+timer_clock::time_point test_01 (void)
+{
+  return timer_clock::now ();
+}
+
+// factor loaded from memory.
+runtime_clock::time_point test_02 (void)
+{
+  return runtime_clock::now ();
+}
+
+// simulated counter.  every register read advances the counter.
+struct sim_counter
+{
+  uint64_t value;
+  uint64_t step;
+};
+
+struct sim_reg
+{
+  typedef uint32_t base_type;
+
+  sim_counter* counter;
+  bool high;
+
+  uint32_t read (void) const
+  {
+    const uint64_t v = counter->value;
+    counter->value += counter->step;
+    return high ? uint32_t (v >> 32) : uint32_t (v);
+  }
+};
+
+typedef hw_counter_mapped_split_source<sim_reg> sim_source;
+typedef hw_counter_clock<sim_source, 25000000> sim_clock;
+
+static bool check_tear_free (void)
+{
+  sim_counter c = { 0, 1 };
+  const sim_reg hi = { &c, true };
+  const sim_reg lo = { &c, false };
+  sim_source::attach (hi, lo);
+
+  // a hi, lo read would return 0x100000000 here.
+  for (uint64_t start = 0x1FFFFFFFCull; start <= 0x200000001ull; ++start)
+  {
+    c.value = start;
+    const uint64_t t = sim_source::read ();
+    if (t < start || t >= c.value)
+      return false;
+  }
+
+  // no carry: three reads.
+  c.value = 0x123400000000ull;
+  if (sim_source::read () != 0x123400000001ull || c.value != 0x123400000003ull)
+    return false;
+
+  c.value = 1000;
+  return sim_clock::now ().time_since_epoch () == std::chrono::nanoseconds (40 * 1001);
+}
+
+static bool check_conversion (void)
+{
+  // exact factors.
+  if (timer_clock::factor ().raw () != (uint64_t (40) << 32))
+    return false;
+  if (timer_clock::to_duration (uint64_t (1) << 40).count () != 40 * (int64_t (1) << 40))
+    return false;
+
+  // 1 ms is exactly 3000 ticks.  the factor is rounded to 32 fractional bits,
+  // which is off by less than 50 ns after a day of ticks.
+  if (slow_clock::to_duration (3000).count () != 1000000)
+    return false;
+
+  const uint64_t day = uint64_t (3000000) * 86400;
+  const int64_t err = slow_clock::to_duration (day).count () - int64_t (86400) * 1000000000;
+  if (err < -50 || err > 50)
+    return false;
+
+  runtime_clock::set_frequency (1000000000);
+  if (runtime_clock::to_duration (123456789).count () != 123456789)
+    return false;
+
+  runtime_clock::set_frequency (32768);
+  return runtime_clock::to_duration (32768 * 3600ull).count () == 3600 * 1000000000ll;
+}
+
+// a stopped counter.
+struct frozen_source
+{
+  static uint64_t read (void) { return 1000; }
+};
+
+typedef hw_counter_clock<frozen_source> frozen_clock;
+
+static bool check_frozen (void)
+{
+  frozen_clock::set_frequency (1000000);
+  return frozen_clock::calibrate (std::chrono::milliseconds (1)) == 0
+	 && frozen_clock::to_duration (1000).count () == 1000000;
+}
+
+#if defined (__i386__) || defined (__x86_64__)
+typedef hw_counter_clock<hw_counter_tsc_source> tsc_clock;
+
+static bool check_tsc (void)
+{
+  if (tsc_clock::calibrate () == 0)
+    return false;
+
+  // must be monotonic and roughly track steady_clock.
+  const auto r0 = std::chrono::steady_clock::now ();
+  const auto t0 = tsc_clock::now ();
+  auto prev = t0;
+  for (int i = 0; i < 100000; ++i)
+  {
+    const auto t = tsc_clock::now ();
+    if (t < prev)
+      return false;
+    prev = t;
+  }
+  const auto r1 = std::chrono::steady_clock::now ();
+
+  const auto ref = std::chrono::duration_cast<std::chrono::nanoseconds> (r1 - r0).count ();
+  const auto got = (prev - t0).count ();
+  return got > ref / 2 && got < ref * 2;
+}
+#else
+static bool check_tsc (void) { return true; }
+#endif
+
+int main (void)
+{
+  if (!check_tear_free ())
+    return 1;
+  if (!check_conversion ())
+    return 2;
+  if (!check_tsc ())
+    return 3;
+  if (!check_frozen ())
+    return 4;
+  return 0;
+}
@@ -67,6 +67,125 @@ Example usage with a constant address register:
 
   static constexpr hw_reg_rw<int32_t, const_addr<0xFF000020>> SH4_TRA;
 
+Example usage with registers that are modified by multiple threads:
+
+  struct irq_regs
+  {
+    hw_reg_rw<uint32_t, void, hw_reg_atomic> enable;		// atomic RMW
+    hw_reg_rw<uint32_t, void, hw_reg_lock_striped<>> route;	// RMW under a lock
+    hw_reg_rw<uint32_t> status;				// single owner (default)
+  };
+
+  regs.enable |= 1 << cpu;			// single atomic instruction
+
+The concurrency policy only affects read-modify-write operations such as |=
+and bit field updates with hw_reg_field::set.
+The default single owner policy does not lock.  The atomic policy requires
+registers that support atomic memory operations, e.g. memory-backed or
+coherently mapped registers.
+
+Register access latencies can be profiled by defining __HW_REG_ENABLE_PROFILING__
+before including this header, see hw_reg_profile.hpp.
+
+Code with constant address registers can be run on a host machine by defining
+__HW_REG_ENABLE_HOST_ARENA__ before including this header.  The registers are
+then backed by host memory, see hw_reg_host_arena.hpp.
+
+Memory that is shared with a device, e.g. DMA descriptors or mailbox slots,
+must be ordered against the register accesses that hand it over to the device
+or take it back.  A C++ fence is not sufficient for this.  It only orders
+memory accesses as seen by other CPUs, e.g. on ARM it is a 'dmb ish', which
+does not order normal memory stores against the device.  The DMA barrier
+macros __HW_REG_DMA_WMB__ (before a doorbell write) and __HW_REG_DMA_RMB__
+(after reading a completion register) are used for this instead.  They can
+be defined before including this header to match the platform.  The defaults
+are:
+
+  - ARM: 'dmb oshst' / 'dmb oshld' ('dmb osh' on ARMv7), which order normal
+    memory and device accesses in the outer shareable domain.  Platforms
+    with non-coherent DMA need a 'dsb st' and cache maintenance instead.
+  - x86: compiler barriers only.  This relies on x86-TSO, where stores are
+    not reordered with other stores and loads are not reordered with other
+    loads, and on cache coherent DMA.  Write-combining memory needs an
+    'sfence' instead.
+  - others: a full memory barrier.
+
+Example usage with a FIFO data register:
+
+  struct uart_regs
+  {
+    hw_reg_fifo<uint8_t> data;			// one address, accessed repeatedly
+    hw_reg_fifo_window<uint32_t, 16> tx_buf;	// 16 consecutive addresses
+  };
+
+  regs.data.read_n (buf, len);			// unrolled byte reads
+  regs.tx_buf.write_n (words, 16);		// memcpy-like stores
+
+Example usage with per-channel register banks:
+
+  struct dma_channel
+  {
+    hw_reg_rw<uint32_t> ctrl;
+    hw_reg_rw<uint32_t> src;
+    hw_reg_rw<uint32_t> dst;
+  };
+
+  // 64 channels, 0x40 bytes apart, at a constant base address
+  static constexpr hw_reg_array<dma_channel, 64, 0x40, const_addr<0xA0010000>> DMA_CH;
+
+  DMA_CH[i].src = addr;				// runtime index
+  DMA_CH.at<3> ().ctrl |= 1;			// constant index, constant address
+  DMA_CH.for_each ([] (dma_channel& c) { c.ctrl |= 1; });	// unrolled
+
+Example usage with a cached read-only register:
+
+  static constexpr hw_reg_ro_cached<uint32_t, const_addr<0xA0000000>> CHIP_ID;
+
+  CHIP_ID.probe ();				// single register read
+  if (CHIP_ID & 0x100)				// served from memory
+    ...
+  CHIP_ID.invalidate ();			// after a device reset
+
+Registers of a register block are cached per device instance, e.g. in the
+driver object:
+
+  hw_reg_cached_ref<decltype (regs.id)> id (regs.id);
+
+  if (id & 0x100)				// first read from the device
+    ...
+
+A FIFO data register can also be accessed with wider accesses if the device
+allows it.  The following reads two 32-bit FIFO words per 64-bit access:
+
+  hw_reg_fifo<uint32_t, void, uint64_t> rx_data;
+
+Example usage with register bit fields:
+
+  typedef hw_reg_field<decltype (adc_regs::ctrl), 4, 3> adc_mode;	// bits 4..6
+  typedef hw_reg_field<decltype (adc_regs::ctrl), 8, 8, int8_t> adc_trim;	// signed
+
+  adc_mode::set (regs.ctrl, 5);			// read-modify-write
+  int8_t t = adc_trim::get (regs.ctrl);		// sign extended
+
+Fields holding fixed point values are supported by hw_reg_fixed_point.hpp.
+
+If the device accepts byte or halfword writes into its wider registers, the
+capabilities are declared with the register type and the fields of the
+register inherit them.  Setting a naturally aligned 8 or 16 bit field is then
+a single narrow store without a register read:
+
+  // all registers of the block are byte writable
+  template <typename T> using uart_reg = hw_reg_rw<T, void, hw_reg_single_owner, hw_reg_caps_byte_writable>;
+
+  struct uart_regs
+  {
+    uart_reg<uint32_t> lcr;
+    ...
+  };
+
+  typedef hw_reg_field<decltype (uart_regs::lcr), 8, 8, uint8_t> uart_div;
+
+  uart_div::set (regs.lcr, 0x1A);		// 8-bit store to lcr + 1
 
 --------------------------------------------------------------------------------
 */
@@ -75,7 +194,50 @@ Example usage with a constant address register:
 #define __HWREG_HEADER_INCLUDED__
 
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <type_traits>
+#include <atomic>
+
+// register access profiling, see hw_reg_profile.hpp.
+#ifdef __HW_REG_ENABLE_PROFILING__
+#include "hw_reg_profile.hpp"
+#define __HW_REG_PROFILE_ACCESS__(addr, kind) hw_reg_profile_scope __hw_reg_profile_scope__ (addr, kind)
+#else
+#define __HW_REG_PROFILE_ACCESS__(addr, kind)
+#endif
+
+// relocation of constant register addresses into host memory, see
+// hw_reg_host_arena.hpp.
+#ifdef __HW_REG_ENABLE_HOST_ARENA__
+#include "hw_reg_host_arena.hpp"
+#define __HW_REG_CONST_ADDR__(addr) hw_reg_host_arena::translate (addr)
+#else
+#define __HW_REG_CONST_ADDR__(addr) (addr)
+#endif
+
+// DMA barriers for memory that is shared with devices.
+#ifndef __HW_REG_DMA_WMB__
+#if defined (__aarch64__) || (defined (__arm__) && defined (__ARM_ARCH) && __ARM_ARCH >= 7)
+#define __HW_REG_DMA_WMB__() __asm__ __volatile__ ("dmb oshst" : : : "memory")
+#elif defined (__i386__) || defined (__x86_64__)
+#define __HW_REG_DMA_WMB__() __asm__ __volatile__ ("" : : : "memory")
+#else
+#define __HW_REG_DMA_WMB__() __sync_synchronize ()
+#endif
+#endif
+
+#ifndef __HW_REG_DMA_RMB__
+#if defined (__aarch64__)
+#define __HW_REG_DMA_RMB__() __asm__ __volatile__ ("dmb oshld" : : : "memory")
+#elif defined (__arm__) && defined (__ARM_ARCH) && __ARM_ARCH >= 7
+#define __HW_REG_DMA_RMB__() __asm__ __volatile__ ("dmb osh" : : : "memory")
+#elif defined (__i386__) || defined (__x86_64__)
+#define __HW_REG_DMA_RMB__() __asm__ __volatile__ ("" : : : "memory")
+#else
+#define __HW_REG_DMA_RMB__() __sync_synchronize ()
+#endif
+#endif
 
 #ifndef __HW_REG_BEGIN_NAMESPACE__
 #define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
@@ -118,8 +280,24 @@ template <typename T> struct hw_reg_var<T, void>
 
   volatile T __var;
 		
-  T read (void) const { return __var; }
-  void write (const T& val) { __var = val;  }
+  T read (void) const
+  {
+    __HW_REG_PROFILE_ACCESS__ (&__var, HW_REG_PROFILE_READ);
+    return __var;
+  }
+
+  void write (const T& val)
+  {
+    __HW_REG_PROFILE_ACCESS__ (&__var, HW_REG_PROFILE_WRITE);
+    __var = val;
+  }
+
+  // narrow store of the bytes [offset, offset + sizeof (N)) of the register.
+  template <typename N> void write_part (std::size_t offset, const N& val)
+  {
+    __HW_REG_PROFILE_ACCESS__ (&__var, HW_REG_PROFILE_WRITE);
+    *reinterpret_cast<volatile N*> (reinterpret_cast<volatile unsigned char*> (&__var) + offset) = val;
+  }
 		
   const T* address_of (void) const { return const_cast<const T*> (&__var); }
   T* address_of (void) { return const_cast<T*> (&__var); }
@@ -133,15 +311,207 @@ template <typename T, uintptr_t A> struct hw_reg_var<T, const_addr<A>>
   typedef volatile T var_type;
   typedef var_type* ptr_type;
 		
-  const T* address_of (void) const noexcept { return reinterpret_cast<const T*> (A); }
-  T* address_of (void) noexcept { return reinterpret_cast<T*> (A); }
+  const T* address_of (void) const noexcept { return reinterpret_cast<const T*> (__HW_REG_CONST_ADDR__ (A)); }
+  T* address_of (void) noexcept { return reinterpret_cast<T*> (__HW_REG_CONST_ADDR__ (A)); }
+
+  T read (void) const
+  {
+    const ptr_type p = reinterpret_cast<ptr_type> (__HW_REG_CONST_ADDR__ (A));
+    __HW_REG_PROFILE_ACCESS__ (p, HW_REG_PROFILE_READ);
+    return *p;
+  }
+
+  void write (const T& val) const
+  {
+    const ptr_type p = reinterpret_cast<ptr_type> (__HW_REG_CONST_ADDR__ (A));
+    __HW_REG_PROFILE_ACCESS__ (p, HW_REG_PROFILE_WRITE);
+    *p = val;
+  }
+
+  template <typename N> void write_part (std::size_t offset, const N& val) const
+  {
+    const ptr_type p = reinterpret_cast<ptr_type> (__HW_REG_CONST_ADDR__ (A));
+    __HW_REG_PROFILE_ACCESS__ (p, HW_REG_PROFILE_WRITE);
+    *reinterpret_cast<volatile N*> (reinterpret_cast<volatile unsigned char*> (p) + offset) = val;
+  }
+};
+
+
+// read-modify-write operations of hw_reg.  the concurrency policies below can
+// map them onto atomic instructions.
+struct hw_reg_op_add { template <typename T> T operator () (const T& a, const T& b) const { return a + b; } };
+struct hw_reg_op_sub { template <typename T> T operator () (const T& a, const T& b) const { return a - b; } };
+struct hw_reg_op_mul { template <typename T> T operator () (const T& a, const T& b) const { return a * b; } };
+struct hw_reg_op_div { template <typename T> T operator () (const T& a, const T& b) const { return a / b; } };
+struct hw_reg_op_mod { template <typename T> T operator () (const T& a, const T& b) const { return a % b; } };
+struct hw_reg_op_xor { template <typename T> T operator () (const T& a, const T& b) const { return a ^ b; } };
+struct hw_reg_op_and { template <typename T> T operator () (const T& a, const T& b) const { return a & b; } };
+struct hw_reg_op_or { template <typename T> T operator () (const T& a, const T& b) const { return a | b; } };
+struct hw_reg_op_shr { template <typename T> T operator () (const T& a, const T& b) const { return a >> b; } };
+struct hw_reg_op_shl { template <typename T> T operator () (const T& a, const T& b) const { return a << b; } };
+
+// masked update, the bits in mask are replaced by the operand bits.  used by
+// hw_reg_field.  the operand must not have bits outside of mask.
+template <typename T> struct hw_reg_op_masked
+{
+  T mask;
+  T operator () (const T& a, const T& b) const { return static_cast<T> ((a & ~mask) | b); }
+};
+
+// concurrency policy: the register is accessed by a single thread of execution
+// only, or the caller serializes accesses.  read-modify-write operations are
+// plain volatile load, operation, volatile store sequences without locking.
+struct hw_reg_single_owner
+{
+  template <typename Var, typename Op, typename T> static void rmw (Var& var, Op op, const T& val)
+  {
+    var.write (op (var.read (), val));
+  }
+
+  // narrow store into a part of the register, see hw_reg::write_part.
+  template <typename Var, typename N> static void store_part (Var& var, std::size_t offset, const N& val)
+  {
+    var.write_part (offset, val);
+  }
+};
+
+// concurrency policy: read-modify-write operations are atomic instructions on
+// the register word.  this works only for registers that are memory-backed or
+// mapped coherently, e.g. shared memory of a virtual device or device memory
+// that supports atomic transactions.  plain reads and writes remain single
+// volatile accesses.
+struct hw_reg_atomic
+{
+private:
+  template <typename T, typename Op> static void cas_loop (T* p, Op op, const T& val)
+  {
+    T old = __atomic_load_n (p, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n (p, &old, op (old, val), true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      ;
+  }
+
+#if defined (__cpp_lib_atomic_ref)
+  template <typename T> static void apply (T* p, hw_reg_op_add, const T& val) { std::atomic_ref<T> (*p).fetch_add (val); }
+  template <typename T> static void apply (T* p, hw_reg_op_sub, const T& val) { std::atomic_ref<T> (*p).fetch_sub (val); }
+  template <typename T> static void apply (T* p, hw_reg_op_xor, const T& val) { std::atomic_ref<T> (*p).fetch_xor (val); }
+  template <typename T> static void apply (T* p, hw_reg_op_and, const T& val) { std::atomic_ref<T> (*p).fetch_and (val); }
+  template <typename T> static void apply (T* p, hw_reg_op_or, const T& val) { std::atomic_ref<T> (*p).fetch_or (val); }
+#else
+  template <typename T> static void apply (T* p, hw_reg_op_add, const T& val) { __atomic_fetch_add (p, val, __ATOMIC_SEQ_CST); }
+  template <typename T> static void apply (T* p, hw_reg_op_sub, const T& val) { __atomic_fetch_sub (p, val, __ATOMIC_SEQ_CST); }
+  template <typename T> static void apply (T* p, hw_reg_op_xor, const T& val) { __atomic_fetch_xor (p, val, __ATOMIC_SEQ_CST); }
+  template <typename T> static void apply (T* p, hw_reg_op_and, const T& val) { __atomic_fetch_and (p, val, __ATOMIC_SEQ_CST); }
+  template <typename T> static void apply (T* p, hw_reg_op_or, const T& val) { __atomic_fetch_or (p, val, __ATOMIC_SEQ_CST); }
+#endif
+
+  // operations without a fetch-op instruction.
+  template <typename T, typename Op> static void apply (T* p, Op op, const T& val) { cas_loop (p, op, val); }
+
+public:
+  template <typename Var, typename Op, typename T> static void rmw (Var& var, Op op, const T& val)
+  {
+    static_assert (std::is_integral<T>::value, "hw_reg_atomic requires an integral register type");
+    apply (var.address_of (), op, val);
+  }
+
+  // a single narrow store cannot tear and is seen by the compare-exchange
+  // of other read-modify-write operations.
+  template <typename Var, typename N> static void store_part (Var& var, std::size_t offset, const N& val)
+  {
+    var.write_part (offset, val);
+  }
+};
+
+// concurrency policy: read-modify-write operations are done under a spinlock
+// which is picked from a pool of Stripes locks by the register address.
+// the locks are padded to cache lines, thus registers that map to different
+// locks do not contend.  this works for any kind of register, but all
+// accesses to the register must use the same policy.
+template <std::size_t Stripes = 64> struct hw_reg_lock_striped
+{
+private:
+  static_assert (Stripes > 0 && (Stripes & (Stripes - 1)) == 0
+		 , "hw_reg_lock_striped stripe count must be a power of two");
+
+  struct alignas (64) stripe
+  {
+    bool locked;
+  };
+
+  // zero initialized, i.e. unlocked.
+  static stripe __locks[Stripes];
+
+  static stripe& lock_for (const void* p) noexcept
+  {
+    const uintptr_t a = reinterpret_cast<uintptr_t> (p);
+    return __locks[((a >> 2) ^ (a >> 12)) & (Stripes - 1)];
+  }
+
+  static void lock (stripe& s) noexcept
+  {
+    while (__atomic_exchange_n (&s.locked, true, __ATOMIC_ACQUIRE))
+      while (__atomic_load_n (&s.locked, __ATOMIC_RELAXED))
+      {
+#if defined (__i386__) || defined (__x86_64__)
+	__builtin_ia32_pause ();
+#endif
+      }
+  }
+
+  static void unlock (stripe& s) noexcept
+  {
+    __atomic_store_n (&s.locked, false, __ATOMIC_RELEASE);
+  }
+
+public:
+  template <typename Var, typename Op, typename T> static void rmw (Var& var, Op op, const T& val)
+  {
+    stripe& s = lock_for (var.address_of ());
+    lock (s);
+    var.write (op (var.read (), val));
+    unlock (s);
+  }
+
+  // the narrow store is done under the register's lock as well.  otherwise
+  // the write back of a concurrent read-modify-write could undo it.
+  template <typename Var, typename N> static void store_part (Var& var, std::size_t offset, const N& val)
+  {
+    stripe& s = lock_for (var.address_of ());
+    lock (s);
+    var.write_part (offset, val);
+    unlock (s);
+  }
+};
 
-  T read (void) const { return *(reinterpret_cast<ptr_type> (A)); }
-  void write (const T& val) const { return *(reinterpret_cast<ptr_type> (A)) = val; }
+template <std::size_t Stripes>
+typename hw_reg_lock_striped<Stripes>::stripe hw_reg_lock_striped<Stripes>::__locks[Stripes];
+
+// bus access capabilities of a register.  by default registers accept full
+// width accesses only.  some devices also accept byte or halfword writes into
+// wider registers, which allows updating a byte or halfword field with a
+// single narrow store instead of a read-modify-write.  the capabilities are
+// part of the register type, see hw_reg_field.
+struct hw_reg_caps_full_width
+{
+  static constexpr bool byte_writable = false;
+  static constexpr bool halfword_writable = false;
+};
+
+struct hw_reg_caps_halfword_writable
+{
+  static constexpr bool byte_writable = false;
+  static constexpr bool halfword_writable = true;
 };
 
+struct hw_reg_caps_byte_writable
+{
+  static constexpr bool byte_writable = true;
+  static constexpr bool halfword_writable = true;
+};
 
-template <typename T, bool R, bool W, typename A> class hw_reg
+template <typename T, bool R, bool W, typename A, typename C = hw_reg_single_owner,
+	  typename B = hw_reg_caps_full_width>
+class hw_reg
 {
 private:
   static const std::integral_constant<bool, R> can_read;
@@ -152,10 +522,22 @@ private:
   T read (std::true_type) const { return __var.read (); }
   hw_reg& write (const T& val, std::true_type) { __var.write (val); return *this; }
 
+  template <typename Op> hw_reg& rmw (Op op, const T& val, std::true_type, std::true_type)
+  {
+    C::rmw (__var, op, val);
+    return *this;
+  }
+
   static_assert (hw_reg_var<T,A>::is_valid, "constant hw_reg address must be of type sys::const_addr");
 
 public:
   typedef T base_type;
+  typedef A address_type;
+  typedef C concurrency_policy;
+  typedef B bus_caps;
+
+  static constexpr bool readable = R;
+  static constexpr bool writable = W;
 
   hw_reg (void) noexcept = default;
   hw_reg (const hw_reg&) = delete;
@@ -175,21 +557,619 @@ public:
   hw_reg& operator = (const T& val) { return write (val, can_write); }
 
   // read-write
-  hw_reg& operator += (const T& val) { return write (read (can_read) + val, can_write); }
-  hw_reg& operator -= (const T& val) { return write (read (can_read) - val, can_write); }
-  hw_reg& operator *= (const T& val) { return write (read (can_read) * val, can_write); }
-  hw_reg& operator /= (const T& val) { return write (read (can_read) / val, can_write); }
-  hw_reg& operator %= (const T& val) { return write (read (can_read) % val, can_write); }
-  hw_reg& operator ^= (const T& val) { return write (read (can_read) ^ val, can_write); }
-  hw_reg& operator &= (const T& val) { return write (read (can_read) & val, can_write); }
-  hw_reg& operator |= (const T& val) { return write (read (can_read) | val, can_write); }
-  hw_reg& operator >>= (const T& val) { return write (read (can_read) >> val, can_write); }
-  hw_reg& operator <<= (const T& val) { return write (read (can_read) << val, can_write); }
-};
-
-template<typename T, typename A = void> using hw_reg_w = hw_reg<T,false,true,A>;
-template<typename T, typename A = void> using hw_reg_r = hw_reg<T,true,false,A>;
-template<typename T, typename A = void> using hw_reg_rw = hw_reg<T,true,true,A>;
+  hw_reg& operator += (const T& val) { return rmw (hw_reg_op_add (), val, can_read, can_write); }
+  hw_reg& operator -= (const T& val) { return rmw (hw_reg_op_sub (), val, can_read, can_write); }
+  hw_reg& operator *= (const T& val) { return rmw (hw_reg_op_mul (), val, can_read, can_write); }
+  hw_reg& operator /= (const T& val) { return rmw (hw_reg_op_div (), val, can_read, can_write); }
+  hw_reg& operator %= (const T& val) { return rmw (hw_reg_op_mod (), val, can_read, can_write); }
+  hw_reg& operator ^= (const T& val) { return rmw (hw_reg_op_xor (), val, can_read, can_write); }
+  hw_reg& operator &= (const T& val) { return rmw (hw_reg_op_and (), val, can_read, can_write); }
+  hw_reg& operator |= (const T& val) { return rmw (hw_reg_op_or (), val, can_read, can_write); }
+  hw_reg& operator >>= (const T& val) { return rmw (hw_reg_op_shr (), val, can_read, can_write); }
+  hw_reg& operator <<= (const T& val) { return rmw (hw_reg_op_shl (), val, can_read, can_write); }
+
+  // replace the bits in mask with val, which must be within mask.  this is a
+  // read-modify-write under the concurrency policy.
+  hw_reg& update (const T& mask, const T& val) { return rmw (hw_reg_op_masked<T> { mask }, val, can_read, can_write); }
+
+  // store val into the bytes [offset, offset + sizeof (N)) of the register
+  // with a single narrow store under the concurrency policy.  the register
+  // must accept narrow writes, see bus_caps.
+  template <typename N> void write_part (std::size_t offset, const N& val)
+  {
+    static_assert (W, "hw_reg is not writable");
+    static_assert (sizeof (N) < sizeof (T), "hw_reg narrow store must be narrower than the register");
+    C::store_part (__var, offset, val);
+  }
+};
+
+template<typename T, typename A = void, typename C = hw_reg_single_owner, typename B = hw_reg_caps_full_width>
+using hw_reg_w = hw_reg<T,false,true,A,C,B>;
+template<typename T, typename A = void, typename C = hw_reg_single_owner, typename B = hw_reg_caps_full_width>
+using hw_reg_r = hw_reg<T,true,false,A,C,B>;
+template<typename T, typename A = void, typename C = hw_reg_single_owner, typename B = hw_reg_caps_full_width>
+using hw_reg_rw = hw_reg<T,true,true,A,C,B>;
+
+// bus access capabilities of a register type.  registers without a bus_caps
+// type accept full width accesses only.
+template <typename Reg, typename Enable = void> struct hw_reg_bus_caps
+{
+  typedef hw_reg_caps_full_width type;
+};
+
+template <typename Reg>
+struct hw_reg_bus_caps<Reg, typename std::enable_if<std::is_class<typename Reg::bus_caps>::value>::type>
+{
+  typedef typename Reg::bus_caps type;
+};
+
+
+// cached value of a read-only register.  the register is read on the first
+// access after construction or invalidate.  concurrent first accesses might
+// read the register more than once, but all of them get the same value.
+template <typename T> class hw_reg_cache
+{
+public:
+  template <typename Read> T get (Read read) const
+  {
+    T val;
+    if (__atomic_load_n (&__valid, __ATOMIC_ACQUIRE))
+      __atomic_load (&__value, &val, __ATOMIC_RELAXED);
+    else
+    {
+      val = read ();
+      __atomic_store (&__value, &val, __ATOMIC_RELAXED);
+      __atomic_store_n (&__valid, true, __ATOMIC_RELEASE);
+    }
+    return val;
+  }
+
+  void invalidate (void) const noexcept { __atomic_store_n (&__valid, false, __ATOMIC_RELEASE); }
+
+private:
+  mutable T __value;
+  mutable bool __valid;
+};
+
+// hwreg read-only register whose value does not change after the device has
+// been probed, e.g. identification, revision and capability registers.
+// the register is read once, either on the first read or with an explicit
+// probe, and all further reads are served from memory until invalidate.
+// the cached value lives in static storage, thus the register must have a
+// constant address.  a cache in a register block member would change the
+// layout of the block, use hw_reg_cached_ref for those.
+template <typename T, typename A> class hw_reg_ro_cached
+{
+private:
+  hw_reg_var<T,A> __var;
+
+  static_assert (!std::is_void<A>::value, "hw_reg_ro_cached must have a constant address, "
+					  "use hw_reg_cached_ref for register block members");
+  static_assert (hw_reg_var<T,A>::is_valid, "constant hw_reg address must be of type sys::const_addr");
+
+  // zero initialized static storage, i.e. invalid.
+  static hw_reg_cache<T> __cache;
+
+  static T cached (void) { return __cache.get ([] (void) { return hw_reg_var<T,A> ().read (); }); }
+
+public:
+  typedef T base_type;
+  typedef A address_type;
+
+  static constexpr bool readable = true;
+  static constexpr bool writable = false;
+
+  hw_reg_ro_cached (void) noexcept = default;
+  hw_reg_ro_cached (const hw_reg_ro_cached&) = delete;
+  ~hw_reg_ro_cached (void) noexcept = default;
+  hw_reg_ro_cached& operator = (const hw_reg_ro_cached&) = delete;
+
+  auto operator & (void) const noexcept -> decltype (__var.address_of ()) { return __var.address_of (); }
+  auto operator & (void) noexcept -> decltype (__var.address_of ()) { return __var.address_of (); }
+
+  // read the register now if it has not been read yet, e.g. during driver
+  // initialization, to keep the register access off the fast path.
+  T probe (void) const { return cached (); }
+
+  T read (void) const { return cached (); }
+  operator T (void) const { return cached (); }
+
+  // read the register again on the next access, e.g. after a device reset.
+  void invalidate (void) const noexcept { __cache.invalidate (); }
+};
+
+template <typename T, typename A> hw_reg_cache<T> hw_reg_ro_cached<T,A>::__cache;
+
+// cached read-only access to a register of a register block.  the object
+// refers to the register and holds the cached value, e.g. as a member of a
+// driver object for one device instance.
+template <typename Reg> class hw_reg_cached_ref
+{
+public:
+  typedef typename Reg::base_type base_type;
+
+  static_assert (Reg::readable, "hw_reg_cached_ref register is not readable");
+
+  explicit hw_reg_cached_ref (const Reg& reg) noexcept : __reg (reg)
+  {
+    invalidate ();
+  }
+
+  hw_reg_cached_ref (const hw_reg_cached_ref&) = delete;
+  hw_reg_cached_ref& operator = (const hw_reg_cached_ref&) = delete;
+
+  const Reg& reg (void) const noexcept { return __reg; }
+
+  base_type probe (void) const { return read (); }
+  base_type read (void) const { return __cache.get ([this] (void) { return __reg.read (); }); }
+  operator base_type (void) const { return read (); }
+
+  void invalidate (void) const noexcept { __cache.invalidate (); }
+
+private:
+  const Reg& __reg;
+  hw_reg_cache<base_type> __cache;
+};
+
+
+// value conversion of hw_reg_field values.  the default passes the field bits
+// as an integer of type V.  specializations can convert the field bits into
+// other value types, see hw_reg_fixed_point.hpp.
+//   from_raw gets the field bits, sign extended if is_signed is true.
+//   to_raw converts a value into field bits.  bits outside of the field are
+//   discarded by the caller.
+template <typename V, typename Enable = void> struct hw_reg_field_traits
+{
+  static_assert (std::is_integral<V>::value || std::is_enum<V>::value
+		 , "hw_reg_field value type needs a hw_reg_field_traits specialization");
+
+  static constexpr bool is_signed = std::is_signed<V>::value;
+
+  template <typename R> static constexpr V from_raw (R raw) noexcept { return static_cast<V> (raw); }
+  template <typename R, unsigned Width> static constexpr R to_raw (const V& val) noexcept { return static_cast<R> (val); }
+};
+
+// clamp a raw value to the range of a Width bit field.
+template <unsigned Width> constexpr intmax_t hw_reg_field_saturate (intmax_t val) noexcept
+{
+  return Width >= sizeof (intmax_t) * 8 ? val
+	 : val > (intmax_t (1) << (Width - 1)) - 1 ? (intmax_t (1) << (Width - 1)) - 1
+	 : val < -(intmax_t (1) << (Width - 1)) ? -(intmax_t (1) << (Width - 1))
+	 : val;
+}
+
+template <unsigned Width> constexpr uintmax_t hw_reg_field_saturate (uintmax_t val) noexcept
+{
+  return Width >= sizeof (uintmax_t) * 8 ? val
+	 : val > (uintmax_t (1) << Width) - 1 ? (uintmax_t (1) << Width) - 1
+	 : val;
+}
+
+// hwreg bit field descriptor.  the bits [Pos, Pos + Width) of the register
+// type Reg hold a value of type V.  the descriptor has no storage, the field
+// is accessed through the register object, e.g.
+//   typedef hw_reg_field<decltype (adc_regs::ctrl), 4, 3> adc_mode;
+//   adc_mode::set (regs.ctrl, 5);
+// the bus access capabilities are taken from the register type.  if the
+// register is byte or halfword writable, set uses a single narrow store for
+// naturally aligned 8 and 16 bit fields.
+template <typename Reg, unsigned Pos, unsigned Width, typename V = typename Reg::base_type>
+class hw_reg_field
+{
+public:
+  typedef typename Reg::base_type base_type;
+  typedef V value_type;
+  typedef hw_reg_field_traits<V> traits;
+  typedef typename hw_reg_bus_caps<Reg>::type caps;
+
+  static constexpr unsigned position = Pos;
+  static constexpr unsigned width = Width;
+
+private:
+  static_assert (std::is_integral<base_type>::value, "hw_reg_field register must be of integral type");
+
+  typedef typename std::make_unsigned<base_type>::type ubase_type;
+  typedef typename std::make_signed<base_type>::type sbase_type;
+  typedef typename std::conditional<traits::is_signed, sbase_type, ubase_type>::type raw_type;
+
+  static constexpr unsigned bits = sizeof (base_type) * 8;
+
+  static_assert (Width > 0 && Pos + Width <= bits, "hw_reg_field does not fit into the register");
+
+  typedef typename std::conditional<Width == 8, uint8_t, uint16_t>::type narrow_type;
+
+  // byte offset of the field within the register in memory.
+  static constexpr unsigned narrow_offset =
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    (bits - Pos - Width) / 8;
+#else
+    Pos / 8;
+#endif
+
+  static void set (Reg& reg, const V& val, std::false_type)
+  {
+    reg.update (mask, encode (val));
+  }
+
+  static void set (Reg& reg, const V& val, std::true_type)
+  {
+    static_assert (Reg::writable, "hw_reg_field register is not writable");
+    reg.write_part (narrow_offset, static_cast<narrow_type> (static_cast<ubase_type> (encode (val)) >> Pos));
+  }
+
+public:
+  static constexpr base_type mask = static_cast<base_type> ((Width == bits ? ~ubase_type (0)
+							     : (ubase_type (1) << Width) - 1) << Pos);
+
+  // true if set is done with a single narrow store.
+  static constexpr bool narrow_store = Width < bits && Pos % Width == 0
+				       && ((Width == 8 && caps::byte_writable)
+					   || (Width == 16 && caps::halfword_writable));
+
+  // extract the field value from a register value.  signed fields are sign
+  // extended with a left / right shift pair.
+  static constexpr V decode (base_type reg_val) noexcept
+  {
+    return traits::is_signed
+	   ? traits::template from_raw<raw_type> (static_cast<raw_type> (
+		static_cast<sbase_type> (static_cast<ubase_type> (static_cast<ubase_type> (reg_val) << (bits - Pos - Width)))
+		>> (bits - Width)))
+	   : traits::template from_raw<raw_type> (static_cast<raw_type> (
+		(static_cast<ubase_type> (reg_val) & static_cast<ubase_type> (mask)) >> Pos));
+  }
+
+  // place a field value into a register value.  other bits are zero.
+  static constexpr base_type encode (const V& val) noexcept
+  {
+    return static_cast<base_type> ((static_cast<ubase_type> (traits::template to_raw<raw_type, Width> (val)) << Pos)
+				   & static_cast<ubase_type> (mask));
+  }
+
+  static V get (const Reg& reg) { return decode (reg.read ()); }
+
+  // read-modify-write of the field under the concurrency policy of the
+  // register, or a narrow store if possible.
+  static void set (Reg& reg, const V& val) { set (reg, val, std::integral_constant<bool, narrow_store> ()); }
+
+  // write the field without reading the register.  the other bits of the
+  // register are written as zero.
+  static void write (Reg& reg, const V& val) { reg = encode (val); }
+};
+
+// hwreg FIFO data port.  a single register address that is read or written
+// repeatedly to pop or push data words.
+// AccessT is the type used for the bus accesses in read_n and write_n.  it can
+// be wider than T (e.g. uint64_t or a vector type) if the device accepts wide
+// accesses to the data port and splits them into multiple FIFO words.  the
+// data port must then be aligned to the size of AccessT.
+template <typename T, typename A = void, typename AccessT = T> class hw_reg_fifo
+{
+private:
+  hw_reg_var<T,A> __var;
+
+  static constexpr std::size_t words_per_access = sizeof (AccessT) / sizeof (T);
+
+  static_assert (hw_reg_var<T,A>::is_valid, "constant hw_reg address must be of type sys::const_addr");
+  static_assert (sizeof (AccessT) >= sizeof (T) && sizeof (AccessT) % sizeof (T) == 0
+		 , "hw_reg_fifo access type must be a multiple of the base type");
+
+  const volatile AccessT* port (void) const { return reinterpret_cast<const volatile AccessT*> (__var.address_of ()); }
+  volatile AccessT* port (void) { return reinterpret_cast<volatile AccessT*> (__var.address_of ()); }
+
+public:
+  typedef T base_type;
+  typedef AccessT access_type;
+
+  hw_reg_fifo (void) noexcept = default;
+  hw_reg_fifo (const hw_reg_fifo&) = delete;
+  ~hw_reg_fifo (void) noexcept = default;
+  hw_reg_fifo& operator = (const hw_reg_fifo&) = delete;
+
+  auto operator & (void) const noexcept -> decltype (__var.address_of ()) { return __var.address_of (); }
+  auto operator & (void) noexcept -> decltype (__var.address_of ()) { return __var.address_of (); }
+
+  T read (void) const { return __var.read (); }
+  void write (const T& val) { __var.write (val); }
+
+  // pop n words from the FIFO.
+  void read_n (T* dst, std::size_t n) const
+  {
+    const volatile AccessT* p = port ();
+    const std::size_t step = words_per_access;
+
+    for (; n >= 4 * step; n -= 4 * step, dst += 4 * step)
+    {
+      const AccessT v0 = *p;
+      const AccessT v1 = *p;
+      const AccessT v2 = *p;
+      const AccessT v3 = *p;
+      std::memcpy (dst + 0 * step, &v0, sizeof (AccessT));
+      std::memcpy (dst + 1 * step, &v1, sizeof (AccessT));
+      std::memcpy (dst + 2 * step, &v2, sizeof (AccessT));
+      std::memcpy (dst + 3 * step, &v3, sizeof (AccessT));
+    }
+
+    for (; n >= step; n -= step, dst += step)
+    {
+      const AccessT v = *p;
+      std::memcpy (dst, &v, sizeof (AccessT));
+    }
+
+    for (; n > 0; --n)
+      *dst++ = __var.read ();
+  }
+
+  // push n words into the FIFO.
+  void write_n (const T* src, std::size_t n)
+  {
+    volatile AccessT* p = port ();
+    const std::size_t step = words_per_access;
+
+    for (; n >= 4 * step; n -= 4 * step, src += 4 * step)
+    {
+      AccessT v0, v1, v2, v3;
+      std::memcpy (&v0, src + 0 * step, sizeof (AccessT));
+      std::memcpy (&v1, src + 1 * step, sizeof (AccessT));
+      std::memcpy (&v2, src + 2 * step, sizeof (AccessT));
+      std::memcpy (&v3, src + 3 * step, sizeof (AccessT));
+      *p = v0;
+      *p = v1;
+      *p = v2;
+      *p = v3;
+    }
+
+    for (; n >= step; n -= step, src += step)
+    {
+      AccessT v;
+      std::memcpy (&v, src, sizeof (AccessT));
+      *p = v;
+    }
+
+    for (; n > 0; --n)
+      __var.write (*src++);
+  }
+};
+
+// hwreg address-incrementing data window.  N consecutive registers of type T,
+// usually a device buffer that is accessed like memory.  read_n and write_n
+// use the wider AccessT for the naturally aligned middle part of a transfer.
+template <typename T, std::size_t N, typename A = void, typename AccessT = T> class hw_reg_fifo_window
+{
+private:
+  // only register block members occupy storage for the whole window.
+  typedef typename std::conditional<std::is_void<A>::value,
+				    hw_reg_var<T,A>[N], hw_reg_var<T,A>[1]>::type var_type;
+  var_type __var;
+
+  static constexpr std::size_t words_per_access = sizeof (AccessT) / sizeof (T);
+
+  static_assert (hw_reg_var<T,A>::is_valid, "constant hw_reg address must be of type sys::const_addr");
+  static_assert (N > 0, "hw_reg_fifo_window size cannot be zero");
+  static_assert (sizeof (AccessT) >= sizeof (T) && sizeof (AccessT) % sizeof (T) == 0
+		 , "hw_reg_fifo_window access type must be a multiple of the base type");
+
+  const volatile T* port (void) const { return __var[0].address_of (); }
+  volatile T* port (void) { return __var[0].address_of (); }
+
+  static bool is_aligned (const volatile T* p) noexcept
+  {
+    return reinterpret_cast<uintptr_t> (p) % sizeof (AccessT) == 0;
+  }
+
+public:
+  typedef T base_type;
+  typedef AccessT access_type;
+  static constexpr std::size_t size = N;
+
+  hw_reg_fifo_window (void) noexcept = default;
+  hw_reg_fifo_window (const hw_reg_fifo_window&) = delete;
+  ~hw_reg_fifo_window (void) noexcept = default;
+  hw_reg_fifo_window& operator = (const hw_reg_fifo_window&) = delete;
+
+  auto operator & (void) const noexcept -> decltype (__var[0].address_of ()) { return __var[0].address_of (); }
+  auto operator & (void) noexcept -> decltype (__var[0].address_of ()) { return __var[0].address_of (); }
+
+  // read n words starting at word offset.  offset + n must not exceed N.
+  void read_n (T* dst, std::size_t n, std::size_t offset = 0) const
+  {
+    const volatile T* p = port () + offset;
+
+    for (; n > 0 && !is_aligned (p); --n)
+      *dst++ = *p++;
+
+    const volatile AccessT* wp = reinterpret_cast<const volatile AccessT*> (p);
+    for (; n >= words_per_access; n -= words_per_access, dst += words_per_access, p += words_per_access)
+    {
+      const AccessT v = *wp++;
+      std::memcpy (dst, &v, sizeof (AccessT));
+    }
+
+    for (; n > 0; --n)
+      *dst++ = *p++;
+  }
+
+  // write n words starting at word offset.  offset + n must not exceed N.
+  void write_n (const T* src, std::size_t n, std::size_t offset = 0)
+  {
+    volatile T* p = port () + offset;
+
+    for (; n > 0 && !is_aligned (p); --n)
+      *p++ = *src++;
+
+    volatile AccessT* wp = reinterpret_cast<volatile AccessT*> (p);
+    for (; n >= words_per_access; n -= words_per_access, src += words_per_access, p += words_per_access)
+    {
+      AccessT v;
+      std::memcpy (&v, src, sizeof (AccessT));
+      *wp++ = v;
+    }
+
+    for (; n > 0; --n)
+      *p++ = *src++;
+  }
+};
+
+// helper to unroll an operation over the Count elements starting at Begin of
+// a hw_reg_array at compile time.  the range is split in halves, thus the
+// template recursion depth is log2 of the array size.
+template <std::size_t Begin, std::size_t Count> struct hw_reg_array_unroll
+{
+  template <typename Array, typename F> static void apply (Array& a, F& f)
+  {
+    hw_reg_array_unroll<Begin, Count / 2>::apply (a, f);
+    hw_reg_array_unroll<Begin + Count / 2, Count - Count / 2>::apply (a, f);
+  }
+};
+
+template <std::size_t Begin> struct hw_reg_array_unroll<Begin, 1>
+{
+  template <typename Array, typename F> static void apply (Array& a, F& f) { f (a.template at<Begin> ()); }
+};
+
+template <std::size_t Begin> struct hw_reg_array_unroll<Begin, 0>
+{
+  template <typename Array, typename F> static void apply (Array&, F&) { }
+};
+
+// bulk operations of hw_reg_array.  the const overloads are used by arrays at
+// constant addresses, which can be declared as static constexpr objects.
+template <typename Derived, std::size_t N> class hw_reg_array_base
+{
+private:
+  Derived& derived (void) noexcept { return static_cast<Derived&> (*this); }
+  const Derived& derived (void) const noexcept { return static_cast<const Derived&> (*this); }
+
+  template <typename T> struct write_op
+  {
+    const T& val;
+    template <typename R> void operator () (R& r) const { r = val; }
+  };
+
+  template <typename T> struct or_op
+  {
+    const T& val;
+    template <typename R> void operator () (R& r) const { r |= val; }
+  };
+
+  template <typename T> struct and_op
+  {
+    const T& val;
+    template <typename R> void operator () (R& r) const { r &= val; }
+  };
+
+  template <typename T> struct xor_op
+  {
+    const T& val;
+    template <typename R> void operator () (R& r) const { r ^= val; }
+  };
+
+public:
+  static constexpr std::size_t size = N;
+
+  // call f for every element in ascending address order.
+  // the loop is unrolled at compile time.
+  template <typename F> void for_each (F f) { hw_reg_array_unroll<0, N>::apply (derived (), f); }
+  template <typename F> void for_each (F f) const { hw_reg_array_unroll<0, N>::apply (derived (), f); }
+
+  // bulk operations for arrays of registers (as opposed to register blocks).
+  template <typename T> void write_all (const T& val) { for_each (write_op<T> { val }); }
+  template <typename T> void write_all (const T& val) const { for_each (write_op<T> { val }); }
+  template <typename T> void or_all (const T& val) { for_each (or_op<T> { val }); }
+  template <typename T> void or_all (const T& val) const { for_each (or_op<T> { val }); }
+  template <typename T> void and_all (const T& val) { for_each (and_op<T> { val }); }
+  template <typename T> void and_all (const T& val) const { for_each (and_op<T> { val }); }
+  template <typename T> void xor_all (const T& val) { for_each (xor_op<T> { val }); }
+  template <typename T> void xor_all (const T& val) const { for_each (xor_op<T> { val }); }
+};
+
+// hwreg array of N registers or register blocks which are Stride bytes apart.
+// e.g. per-channel register banks of a DMA controller.
+template <typename Reg, std::size_t N, std::size_t Stride = sizeof (Reg), typename A = void>
+class hw_reg_array
+{
+  // NG: unsupported address type
+  static_assert (hw_reg_var<int,A>::is_valid, "constant hw_reg address must be of type sys::const_addr");
+};
+
+// hwreg array without specified address
+// i.e. used as a member of a hw register block struct
+template <typename Reg, std::size_t N, std::size_t Stride>
+class hw_reg_array<Reg, N, Stride, void>
+  : public hw_reg_array_base<hw_reg_array<Reg, N, Stride, void>, N>
+{
+  static_assert (N > 0, "hw_reg_array size cannot be zero");
+  static_assert (Stride >= sizeof (Reg) && Stride % alignof (Reg) == 0
+		 , "hw_reg_array stride must be at least the element size and keep its alignment");
+
+  alignas (Reg) unsigned char __storage[N * Stride];
+
+public:
+  typedef Reg value_type;
+  static constexpr std::size_t stride = Stride;
+
+  hw_reg_array (void) noexcept = default;
+  hw_reg_array (const hw_reg_array&) = delete;
+  hw_reg_array& operator = (const hw_reg_array&) = delete;
+
+  Reg& operator [] (std::size_t i) noexcept { return *reinterpret_cast<Reg*> (__storage + i * Stride); }
+  const Reg& operator [] (std::size_t i) const noexcept { return *reinterpret_cast<const Reg*> (__storage + i * Stride); }
+
+  // element with constant index.
+  template <std::size_t I> Reg& at (void) noexcept
+  {
+    static_assert (I < N, "hw_reg_array index out of range");
+    return (*this)[I];
+  }
+
+  template <std::size_t I> const Reg& at (void) const noexcept
+  {
+    static_assert (I < N, "hw_reg_array index out of range");
+    return (*this)[I];
+  }
+};
+
+// hwreg array with specified constant base address
+template <typename Reg, std::size_t N, std::size_t Stride, uintptr_t A>
+class hw_reg_array<Reg, N, Stride, const_addr<A>>
+  : public hw_reg_array_base<hw_reg_array<Reg, N, Stride, const_addr<A>>, N>
+{
+  static_assert (N > 0, "hw_reg_array size cannot be zero");
+  static_assert (Stride >= sizeof (Reg) && Stride % alignof (Reg) == 0
+		 , "hw_reg_array stride must be at least the element size and keep its alignment");
+  static_assert (A % alignof (Reg) == 0, "hw_reg_array base address is misaligned");
+
+  template <std::size_t I> struct checked_element_addr
+  {
+    static_assert (I < N, "hw_reg_array index out of range");
+    typedef const_addr<A + I * Stride> type;
+  };
+
+public:
+  typedef Reg value_type;
+  static constexpr std::size_t stride = Stride;
+
+  // constant address of the element I.  if the elements are registers, this
+  // can be used to declare the element as a separate hw_reg, e.g.
+  //   hw_reg_rw<uint32_t, my_array::element_addr<3>> ch3_ctrl;
+  template <std::size_t I> using element_addr = typename checked_element_addr<I>::type;
+
+  constexpr hw_reg_array (void) noexcept = default;
+  hw_reg_array (const hw_reg_array&) = delete;
+  hw_reg_array& operator = (const hw_reg_array&) = delete;
+
+  // the registers are at a fixed address, thus constness of the array object
+  // does not matter.  this allows static constexpr array objects.
+  Reg& operator [] (std::size_t i) const noexcept
+  {
+    return *reinterpret_cast<Reg*> (__HW_REG_CONST_ADDR__ (A + i * Stride));
+  }
+
+  // element with constant index.  resolves to a constant address.
+  template <std::size_t I> Reg& at (void) const noexcept
+  {
+    return *reinterpret_cast<Reg*> (__HW_REG_CONST_ADDR__ (element_addr<I>::value));
+  }
+};
 
 __HW_REG_END_NAMESPACE__
 
@@ -203,5 +1183,8 @@ __HW_REG_END_NAMESPACE__
 #undef __HW_REG_END_NAMESPACE__
 #endif
 
+#undef __HW_REG_PROFILE_ACCESS__
+#undef __HW_REG_CONST_ADDR__
+
 #endif // __HWREG_HEADER_INCLUDED__
 
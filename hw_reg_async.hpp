@@ -0,0 +1,409 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register asynchronous polling C++ template classes
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++20 language and library features (coroutines) and
+thus requires a compiler and an STL implementation that supports C++20.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+Polling a register until some bits reach a certain state is usually done with
+a busy loop.  When many device channels are driven at the same time, a
+thread per polling loop wastes cores.  The classes in this file allow
+writing the polling code as C++20 coroutines, which are all driven by a
+single scheduler thread.
+
+A coroutine that waits for register conditions must return hw_reg_task.
+Inside the coroutine, a register condition is awaited with reg_condition,
+which reads the register through the normal hw_reg read path:
+
+  hw_reg_task reset_channel (channel_regs& r)
+  {
+    r.ctrl |= CTRL_RESET;
+    co_await reg_condition (r.status, STATUS_READY, STATUS_READY);
+    r.ctrl = CTRL_ENABLE;
+  }
+
+The tasks are handed over to a hw_reg_poll_scheduler, which runs them until
+all of them have finished:
+
+  hw_reg_poll_scheduler sched;
+  for (auto& c : channels)
+    sched.spawn (reset_channel (c));
+  sched.run ();
+
+The scheduler keeps the pending conditions sorted by register address.
+In each polling pass a register is read only once, even if several
+conditions are waiting on it.  The polling interval of each condition starts
+at the scheduler's initial interval and doubles after every unsuccessful
+poll until it reaches the maximum interval.  If no condition is due, the
+scheduler thread yields or sleeps until the next one is.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_ASYNC_HEADER_INCLUDED__
+#define __HWREG_ASYNC_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <coroutine>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+class hw_reg_poll_scheduler;
+
+// coroutine return type for tasks that are run by hw_reg_poll_scheduler.
+// tasks start suspended and are started by the scheduler.
+class hw_reg_task
+{
+public:
+  struct promise_type
+  {
+    hw_reg_poll_scheduler* sched = nullptr;
+
+    hw_reg_task get_return_object (void) noexcept
+    {
+      return hw_reg_task (std::coroutine_handle<promise_type>::from_promise (*this));
+    }
+
+    std::suspend_always initial_suspend (void) const noexcept { return { }; }
+    std::suspend_always final_suspend (void) const noexcept { return { }; }
+    void return_void (void) const noexcept { }
+    void unhandled_exception (void) const noexcept { std::abort (); }
+  };
+
+  typedef std::coroutine_handle<promise_type> handle_type;
+
+  hw_reg_task (void) noexcept = default;
+  hw_reg_task (const hw_reg_task&) = delete;
+  hw_reg_task& operator = (const hw_reg_task&) = delete;
+
+  hw_reg_task (hw_reg_task&& other) noexcept : __h (other.__h) { other.__h = nullptr; }
+
+  hw_reg_task& operator = (hw_reg_task&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (__h)
+	__h.destroy ();
+      __h = other.__h;
+      other.__h = nullptr;
+    }
+    return *this;
+  }
+
+  ~hw_reg_task (void)
+  {
+    if (__h)
+      __h.destroy ();
+  }
+
+  bool valid (void) const noexcept { return (bool)__h; }
+  bool done (void) const noexcept { return !__h || __h.done (); }
+
+  // transfer ownership of the coroutine frame, used by the scheduler.
+  handle_type release (void) noexcept
+  {
+    handle_type h = __h;
+    __h = nullptr;
+    return h;
+  }
+
+private:
+  explicit hw_reg_task (handle_type h) noexcept : __h (h) { }
+
+  handle_type __h = nullptr;
+};
+
+
+// single threaded scheduler that runs hw_reg_task coroutines and polls the
+// register conditions they are waiting for.
+class hw_reg_poll_scheduler
+{
+public:
+  typedef std::chrono::steady_clock clock;
+
+  explicit hw_reg_poll_scheduler (clock::duration initial_interval = std::chrono::microseconds (1),
+				  clock::duration max_interval = std::chrono::microseconds (100)) noexcept
+    : __initial_interval (initial_interval), __max_interval (max_interval)
+  { }
+
+  hw_reg_poll_scheduler (const hw_reg_poll_scheduler&) = delete;
+  hw_reg_poll_scheduler& operator = (const hw_reg_poll_scheduler&) = delete;
+
+  ~hw_reg_poll_scheduler (void)
+  {
+    for (std::coroutine_handle<> h : __tasks)
+      h.destroy ();
+  }
+
+  // take ownership of a task.  it is started on the next run or run_once.
+  void spawn (hw_reg_task&& t)
+  {
+    if (!t.valid () || t.done ())
+      return;
+
+    hw_reg_task::handle_type h = t.release ();
+    h.promise ().sched = this;
+    __tasks.push_back (h);
+    __ready.push_back (h);
+  }
+
+  // number of tasks that have not finished yet.
+  std::size_t task_count (void) const noexcept { return __tasks.size (); }
+
+  // number of register conditions that are currently being polled.
+  std::size_t pending_count (void) const noexcept { return __waiters.size (); }
+
+  // resume all ready tasks and do one polling pass over all due conditions.
+  // returns true if there are unfinished tasks left.
+  bool run_once (void)
+  {
+    resume_ready ();
+    poll (clock::now ());
+    resume_ready ();
+    return !__tasks.empty ();
+  }
+
+  // run until all tasks have finished.
+  void run (void)
+  {
+    while (run_once ())
+    {
+      if (!__ready.empty () || __waiters.empty ())
+	continue;
+
+      const clock::time_point next = next_due ();
+      const clock::time_point now = clock::now ();
+
+      if (next <= now)
+	continue;
+      else if (next - now < __sleep_threshold)
+	std::this_thread::yield ();
+      else
+	std::this_thread::sleep_until (next);
+    }
+  }
+
+  // used by the register condition awaiter.  not supposed to be called directly.
+  void wait (const volatile void* addr, const void* reg,
+	     std::uint64_t (*read_func)(const void*), std::uint64_t mask,
+	     std::uint64_t value, std::coroutine_handle<> h)
+  {
+    waiter w;
+    w.addr = addr;
+    w.reg = reg;
+    w.read = read_func;
+    w.mask = mask;
+    w.value = value;
+    w.handle = h;
+    w.interval = __initial_interval;
+    w.next = clock::now () + w.interval;
+
+    // keep the waiters sorted by register address, so that the polling
+    // pass can read each register only once.
+    __waiters.insert (std::upper_bound (__waiters.begin (), __waiters.end (), w, addr_less), w);
+  }
+
+private:
+  struct waiter
+  {
+    const volatile void* addr;
+    const void* reg;
+    std::uint64_t (*read)(const void*);
+    std::uint64_t mask;
+    std::uint64_t value;
+    std::coroutine_handle<> handle;
+    clock::time_point next;
+    clock::duration interval;
+  };
+
+  static bool addr_less (const waiter& a, const waiter& b) noexcept
+  {
+    return std::less<const volatile void*> () (a.addr, b.addr);
+  }
+
+  void resume_ready (void)
+  {
+    // resuming may spawn or ready other tasks, thus swap out the ready list.
+    while (!__ready.empty ())
+    {
+      __resuming.swap (__ready);
+      for (std::coroutine_handle<> h : __resuming)
+      {
+	h.resume ();
+	if (h.done ())
+	{
+	  __tasks.erase (std::find (__tasks.begin (), __tasks.end (), h));
+	  h.destroy ();
+	}
+      }
+      __resuming.clear ();
+    }
+  }
+
+  void poll (clock::time_point now)
+  {
+    const volatile void* last_addr = nullptr;
+    std::uint64_t last_value = 0;
+
+    std::size_t out = 0;
+    for (std::size_t i = 0; i < __waiters.size (); ++i)
+    {
+      waiter& w = __waiters[i];
+
+      if (w.next <= now)
+      {
+	if (w.addr != last_addr)
+	{
+	  last_value = w.read (w.reg);
+	  last_addr = w.addr;
+	}
+
+	if ((last_value & w.mask) == w.value)
+	{
+	  __ready.push_back (w.handle);
+	  continue;
+	}
+
+	w.interval = std::min<clock::duration> (w.interval * 2, __max_interval);
+	if (w.interval == clock::duration::zero ())
+	  w.interval = std::min<clock::duration> (clock::duration (1), __max_interval);
+	w.next = now + w.interval;
+      }
+
+      if (out != i)
+	__waiters[out] = w;
+      ++out;
+    }
+    __waiters.resize (out);
+  }
+
+  clock::time_point next_due (void) const noexcept
+  {
+    clock::time_point t = clock::time_point::max ();
+    for (const waiter& w : __waiters)
+      t = std::min (t, w.next);
+    return t;
+  }
+
+  const clock::duration __initial_interval;
+  const clock::duration __max_interval;
+  const clock::duration __sleep_threshold = std::chrono::microseconds (50);
+
+  std::vector<std::coroutine_handle<>> __tasks;
+  std::vector<std::coroutine_handle<>> __ready;
+  std::vector<std::coroutine_handle<>> __resuming;
+  std::vector<waiter> __waiters;
+};
+
+
+// awaitable that suspends the current hw_reg_task until
+// (reg & mask) == value.  if the condition is already met, the task is
+// not suspended at all.
+template <typename Reg> class hw_reg_condition
+{
+public:
+  typedef typename Reg::base_type base_type;
+
+  static_assert (std::is_integral<base_type>::value && sizeof (base_type) <= sizeof (std::uint64_t)
+		 , "hw_reg conditions require an integral register type");
+
+  hw_reg_condition (const Reg& reg, base_type mask, base_type value) noexcept
+    : __reg (reg), __mask (mask), __value (value)
+  { }
+
+  bool await_ready (void) const { return (__reg.read () & __mask) == __value; }
+
+  void await_suspend (hw_reg_task::handle_type h) const
+  {
+    h.promise ().sched->wait (&__reg, std::addressof (__reg), &read_reg,
+			      static_cast<std::uint64_t> (__mask),
+			      static_cast<std::uint64_t> (__value), h);
+  }
+
+  void await_resume (void) const noexcept { }
+
+private:
+  static std::uint64_t read_reg (const void* reg)
+  {
+    return static_cast<std::uint64_t> (static_cast<const Reg*> (reg)->read ());
+  }
+
+  const Reg& __reg;
+  const base_type __mask;
+  const base_type __value;
+};
+
+template <typename Reg>
+inline hw_reg_condition<Reg>
+reg_condition (const Reg& reg, typename Reg::base_type mask, typename Reg::base_type value) noexcept
+{
+  return hw_reg_condition<Reg> (reg, mask, value);
+}
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_ASYNC_HEADER_INCLUDED__
@@ -0,0 +1,143 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register asynchronous polling compile-time tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++20 -O2 hw_reg_async_compile_tests.cpp
+
+The register blocks are ordinary memory, so the resulting executable can be
+run on the host.  It returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_async.hpp"
+
+using namespace test_namespace;
+
+struct channel_regs
+{
+  hw_reg_rw	<uint32_t> ctrl;	// control register
+  hw_reg_rw	<uint32_t> status;	// status register, set by the device model
+  hw_reg_r	<uint16_t> id;		// read-only register
+};
+
+static constexpr uint32_t CTRL_START = 1 << 0;
+static constexpr uint32_t STATUS_READY = 1 << 4;
+
+hw_reg_task test_00 (channel_regs& r)
+{
+  r.ctrl = CTRL_START;
+  co_await reg_condition (r.status, STATUS_READY, STATUS_READY);
+  r.ctrl = 0;
+}
+
+hw_reg_task test_01 (channel_regs& r)
+{
+  co_await reg_condition (r.id, 0xFF00, 0x1200);	// read-only register: OK
+}
+
+hw_reg_task test_02 (channel_regs& r)
+{
+//co_await reg_condition (r.ctrl, 1.0f, 0);		// NG: non-integral register
+  co_return;
+}
+
+// device model for test_00: waits for the start bit and sets the ready bit.
+hw_reg_task device_model (channel_regs& r)
+{
+  co_await reg_condition (r.ctrl, CTRL_START, CTRL_START);
+  r.status |= STATUS_READY;
+}
+
+int test_03 (void)
+{
+  static channel_regs ch[16] = { };
+  hw_reg_poll_scheduler sched (std::chrono::microseconds (0), std::chrono::microseconds (10));
+
+  for (channel_regs& c : ch)
+  {
+    sched.spawn (test_00 (c));
+    sched.spawn (device_model (c));
+  }
+
+  if (sched.task_count () != 32)
+    return 1;
+
+  sched.run ();
+
+  for (channel_regs& c : ch)
+    if (c.ctrl != 0 || c.status != STATUS_READY)
+      return 2;
+
+  return sched.task_count () == 0 && sched.pending_count () == 0 ? 0 : 3;
+}
+
+int test_04 (void)
+{
+  // condition already met: task completes without suspending on the register.
+  channel_regs r = { };
+  r.status = STATUS_READY;
+
+  hw_reg_poll_scheduler sched;
+  sched.spawn (test_00 (r));
+  sched.run_once ();
+
+  return sched.task_count () == 0 ? 0 : 1;
+}
+
+int test_05 (void)
+{
+  // unfinished tasks are destroyed together with the scheduler.
+  channel_regs r = { };
+  hw_reg_poll_scheduler sched;
+  sched.spawn (test_00 (r));
+  sched.run_once ();
+
+  return sched.pending_count () == 1 && r.ctrl == CTRL_START ? 0 : 1;
+}
+
+int main (void)
+{
+  if (int r = test_03 ())
+    return r;
+  if (int r = test_04 ())
+    return 10 + r;
+  if (int r = test_05 ())
+    return 20 + r;
+  return 0;
+}
@@ -0,0 +1,384 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register benchmark
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_bench.cpp
+
+Usage:
+  ./a.out [--iterations N] [--regression [TOLERANCE_PERCENT]]
+
+Each access pattern is implemented twice, once with hw_reg and once with
+hand-written volatile accesses, over the same memory-backed register block.
+For each variant the best time out of several rounds is reported in ns per
+operation.  If the kernel permits perf_event_open, the retired user space
+instructions per operation are reported as well.
+
+In regression mode the exit code is non-zero if a hw_reg variant executes
+more instructions than the volatile variant, or, without perf counters, is
+slower by more than the tolerance (default 10%).
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace test_namespace;
+
+// same code alignment for both variants, otherwise identical loops can differ
+// in speed because of where they cross fetch block boundaries.
+#define BENCH_NOINLINE __attribute__ ((noinline, aligned (64)))
+
+enum
+{
+  CTRL_ENABLE = 1 << 0,
+  CTRL_RESET = 1 << 1,
+  STATUS_BUSY = 1 << 0,
+  CFG_COUNT = 16,
+  POLL_COUNT = 32,
+  FIFO_WORDS = 64
+};
+
+// the register block, once as hw_reg and once as plain volatile members.
+struct dev_regs
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_r	<uint32_t> status;
+  hw_reg_rw	<uint32_t> cfg[CFG_COUNT];
+  hw_reg_fifo	<uint32_t> data;
+};
+
+struct dev_regs_raw
+{
+  volatile uint32_t ctrl;
+  volatile uint32_t status;
+  volatile uint32_t cfg[CFG_COUNT];
+  volatile uint32_t data;
+};
+
+static_assert (sizeof (dev_regs) == sizeof (dev_regs_raw), "register block layouts differ");
+
+alignas (64) static uint32_t dev_memory[sizeof (dev_regs) / sizeof (uint32_t)];
+static uint32_t fifo_buffer[FIFO_WORDS];
+
+// ---------------------------------------------------------------------------
+// access patterns.  every function does n operations.
+
+BENCH_NOINLINE uint32_t read_hw (dev_regs& r, std::size_t n)
+{
+  uint32_t sum = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    sum += r.status;
+  return sum;
+}
+
+BENCH_NOINLINE uint32_t read_raw (dev_regs_raw& r, std::size_t n)
+{
+  uint32_t sum = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    sum += r.status;
+  return sum;
+}
+
+BENCH_NOINLINE uint32_t rmw_hw (dev_regs& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    r.ctrl |= CTRL_ENABLE;
+    r.ctrl &= ~CTRL_RESET;
+  }
+  return 0;
+}
+
+BENCH_NOINLINE uint32_t rmw_raw (dev_regs_raw& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    r.ctrl |= CTRL_ENABLE;
+    r.ctrl &= ~CTRL_RESET;
+  }
+  return 0;
+}
+
+// the status register stays busy, every poll runs into its limit.
+BENCH_NOINLINE uint32_t poll_hw (dev_regs& r, std::size_t n)
+{
+  uint32_t timeouts = 0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    unsigned k = 0;
+    while ((r.status & STATUS_BUSY) && ++k < POLL_COUNT)
+      ;
+    timeouts += k == POLL_COUNT;
+  }
+  return timeouts;
+}
+
+BENCH_NOINLINE uint32_t poll_raw (dev_regs_raw& r, std::size_t n)
+{
+  uint32_t timeouts = 0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    unsigned k = 0;
+    while ((r.status & STATUS_BUSY) && ++k < POLL_COUNT)
+      ;
+    timeouts += k == POLL_COUNT;
+  }
+  return timeouts;
+}
+
+BENCH_NOINLINE uint32_t init_hw (dev_regs& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    r.ctrl = CTRL_RESET;
+    for (unsigned j = 0; j < CFG_COUNT; ++j)
+      r.cfg[j] = j * 0x01010101u;
+    r.ctrl = CTRL_ENABLE;
+  }
+  return 0;
+}
+
+BENCH_NOINLINE uint32_t init_raw (dev_regs_raw& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    r.ctrl = CTRL_RESET;
+    for (unsigned j = 0; j < CFG_COUNT; ++j)
+      r.cfg[j] = j * 0x01010101u;
+    r.ctrl = CTRL_ENABLE;
+  }
+  return 0;
+}
+
+BENCH_NOINLINE uint32_t drain_hw (dev_regs& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+    r.data.read_n (fifo_buffer, FIFO_WORDS);
+  return fifo_buffer[0];
+}
+
+BENCH_NOINLINE uint32_t drain_raw (dev_regs_raw& r, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+    for (unsigned j = 0; j < FIFO_WORDS; ++j)
+      fifo_buffer[j] = r.data;
+  return fifo_buffer[0];
+}
+
+// ---------------------------------------------------------------------------
+// measurement.
+
+class insn_counter
+{
+public:
+  insn_counter (void) : __fd (-1)
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset (&attr, 0, sizeof (attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof (attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    __fd = static_cast<int> (syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~insn_counter (void)
+  {
+#ifdef __linux__
+    if (__fd >= 0)
+      close (__fd);
+#endif
+  }
+
+  insn_counter (const insn_counter&) = delete;
+  insn_counter& operator = (const insn_counter&) = delete;
+
+  bool valid (void) const { return __fd >= 0; }
+
+  void start (void)
+  {
+#ifdef __linux__
+    if (__fd >= 0)
+    {
+      ioctl (__fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (__fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  uint64_t stop (void)
+  {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (__fd >= 0)
+    {
+      ioctl (__fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read (__fd, &count, sizeof (count)) != sizeof (count))
+	count = 0;
+    }
+#endif
+    return count;
+  }
+
+private:
+  int __fd;
+};
+
+struct bench_result
+{
+  double ns_per_op;
+  double insns_per_op;
+};
+
+static volatile uint32_t bench_sink;
+
+template <typename Regs>
+static void run_round (uint32_t (*f) (Regs&, std::size_t), Regs& r, std::size_t n,
+		       insn_counter& insns, bench_result& res)
+{
+  insns.start ();
+  const auto t0 = std::chrono::steady_clock::now ();
+  bench_sink = f (r, n);
+  const auto t1 = std::chrono::steady_clock::now ();
+  const uint64_t count = insns.stop ();
+
+  const double ns = std::chrono::duration<double, std::nano> (t1 - t0).count () / n;
+  if (ns < res.ns_per_op)
+    res.ns_per_op = ns;
+  if (double (count) / n < res.insns_per_op)
+    res.insns_per_op = double (count) / n;
+}
+
+struct bench_case
+{
+  const char* name;
+  uint32_t (*hw) (dev_regs&, std::size_t);
+  uint32_t (*raw) (dev_regs_raw&, std::size_t);
+  std::size_t scale;		// divides the iteration count for long operations
+};
+
+static const bench_case cases[] =
+{
+  { "single read", read_hw, read_raw, 1 },
+  { "read-modify-write", rmw_hw, rmw_raw, 1 },
+  { "polling loop", poll_hw, poll_raw, POLL_COUNT },
+  { "block init", init_hw, init_raw, CFG_COUNT },
+  { "fifo drain", drain_hw, drain_raw, FIFO_WORDS }
+};
+
+int main (int argc, char** argv)
+{
+  std::size_t iterations = 10000000;
+  bool regression = false;
+  double tolerance = 10;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp (argv[i], "--iterations") == 0 && i + 1 < argc)
+      iterations = std::strtoul (argv[++i], nullptr, 0);
+    else if (std::strcmp (argv[i], "--regression") == 0)
+    {
+      regression = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+	tolerance = std::strtod (argv[++i], nullptr);
+    }
+    else
+    {
+      std::fprintf (stderr, "usage: %s [--iterations N] [--regression [TOLERANCE_PERCENT]]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  dev_regs& hw = *reinterpret_cast<dev_regs*> (dev_memory);
+  dev_regs_raw& raw = *reinterpret_cast<dev_regs_raw*> (dev_memory);
+  raw.status = STATUS_BUSY;
+
+  insn_counter insns;
+  if (!insns.valid ())
+    std::printf ("perf counters not available, instruction counts not reported\n");
+
+  std::printf ("%-20s %12s %12s %12s %12s %8s\n", "case", "hw_reg ns", "raw ns", "hw_reg insn", "raw insn", "");
+
+  int failed = 0;
+  for (const bench_case& c : cases)
+  {
+    const std::size_t n = iterations / c.scale > 0 ? iterations / c.scale : 1;
+    bench_result h = { 1e30, 1e30 };
+    bench_result v = { 1e30, 1e30 };
+
+    // alternate the variants, so that frequency changes and other
+    // disturbances hit both of them.
+    c.hw (hw, n / 16);
+    c.raw (raw, n / 16);
+    for (int round = 0; round < 7; ++round)
+    {
+      run_round (c.hw, hw, n, insns, h);
+      run_round (c.raw, raw, n, insns, v);
+    }
+
+    // instruction counts are exact, timings are not.
+    const bool slower = insns.valid ()
+			? h.insns_per_op > v.insns_per_op + 0.5
+			: h.ns_per_op > v.ns_per_op * (1 + tolerance / 100);
+    failed += slower;
+
+    if (insns.valid ())
+      std::printf ("%-20s %12.2f %12.2f %12.1f %12.1f %8s\n", c.name, h.ns_per_op, v.ns_per_op,
+		   h.insns_per_op, v.insns_per_op, slower ? "SLOWER" : "");
+    else
+      std::printf ("%-20s %12.2f %12.2f %12s %12s %8s\n", c.name, h.ns_per_op, v.ns_per_op,
+		   "-", "-", slower ? "SLOWER" : "");
+  }
+
+  return regression && failed != 0 ? 1 : 0;
+}
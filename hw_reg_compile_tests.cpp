@@ -199,6 +199,177 @@ void test_26 (regs& r, int32_t val)
 }
 
 
+struct fifo_regs
+{
+  hw_reg_fifo		<uint32_t> rx_data;			// FIFO data port
+  hw_reg_fifo		<uint32_t, void, uint64_t> rx_data_64;	// FIFO data port, 64-bit accesses
+  hw_reg_fifo_window	<uint32_t, 16, void, uint64_t> tx_buf;	// 16 consecutive words
+};
+
+void test_27 (fifo_regs& r, uint32_t* buf)
+{
+  r.rx_data.read_n (buf, 16);	// 16 unrolled 32-bit reads
+}
+
+void test_28 (fifo_regs& r, uint32_t* buf, size_t n)
+{
+  r.rx_data_64.read_n (buf, n);	// n/2 64-bit reads and one 32-bit read if n is odd
+}
+
+void test_29 (fifo_regs& r, const uint32_t* buf)
+{
+  r.tx_buf.write_n (buf, 16);	// 8 64-bit stores
+}
+
+void test_30 (fifo_regs& r, const uint32_t* buf)
+{
+  r.tx_buf.write_n (buf, 4, 1);	// 32-bit, 64-bit, 32-bit store
+}
+
+void test_31 (const uint32_t* buf)
+{
+  hw_reg_fifo<uint32_t, const_addr<0xA0001300>> fifo;	// OK
+  fifo.write_n (buf, 8);
+}
+
+
+struct dma_channel
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_rw	<uint32_t> src;
+  hw_reg_rw	<uint32_t> dst;
+};
+
+struct dma_regs
+{
+  hw_reg_array	<dma_channel, 64, 0x40> ch;			// 64 channels, 0x40 bytes apart
+  hw_reg_array	<hw_reg_rw<uint32_t>, 8> irq_mask;		// 8 consecutive registers
+};
+
+static constexpr hw_reg_array<dma_channel, 64, 0x40, const_addr<0xA0010000>> g_dma_ch;
+static constexpr hw_reg_array<hw_reg_rw<uint32_t>, 4, 0x10, const_addr<0xA0020000>> g_timer_ctrl;
+
+void test_32 (dma_regs& r, unsigned i, uint32_t addr)
+{
+  r.ch[i].src = addr;		// runtime index
+}
+
+void test_33 (dma_regs& r)
+{
+  r.ch.at<3> ().ctrl |= 1;	// constant index
+//r.ch.at<64> ().ctrl |= 1;	// NG: compile time error, index out of range
+}
+
+void test_34 (dma_regs& r)
+{
+  r.ch.for_each ([] (dma_channel& c) { c.ctrl |= 1; });	// 64 unrolled RMW sequences
+}
+
+void test_35 (dma_regs& r)
+{
+  r.irq_mask.write_all (0u);
+}
+
+// the unrolling recursion depth is log2 of the size, larger arrays than the
+// template depth limit are fine.
+static constexpr hw_reg_array<hw_reg_rw<uint32_t>, 1024, 4, const_addr<0xA0400000>> g_lut;
+
+void test_35_1 (void)
+{
+  g_lut.write_all (0u);		// 1024 stores
+}
+
+void test_36 (unsigned i, uint32_t addr)
+{
+  g_dma_ch[i].dst = addr;
+  g_dma_ch.at<5> ().ctrl = 0;	// constant address 0xA0010140
+}
+
+void test_37 (void)
+{
+  g_timer_ctrl.or_all (0x80u);
+}
+
+int test_38 (void)
+{
+  hw_reg_rw<uint32_t, decltype (g_timer_ctrl)::element_addr<2>> timer2;	// 0xA0020020
+  return &timer2 == (uint32_t*)0xA0020020;
+}
+
+static_assert (sizeof (dma_regs) == 64 * 0x40 + 8 * 4, "unexpected register block layout");
+
+static constexpr hw_reg_ro_cached<uint32_t, const_addr<0xA0030000>> g_chip_caps;
+
+void test_39 (void)
+{
+  g_chip_caps.probe ();		// single register read
+}
+
+bool test_40 (void)
+{
+  return g_chip_caps & 0x10;	// served from memory after the first read
+//g_chip_caps = 0;		// NG: compile time error, read-only
+}
+
+void test_40_1 (void)
+{
+  g_chip_caps.invalidate ();	// next access reads the register again
+}
+
+//hw_reg_ro_cached<uint32_t, void> cached_member;	// NG: compile time error, needs a constant address
+
+struct chip_regs
+{
+  hw_reg_r	<uint32_t> id;
+  hw_reg_w	<uint32_t> reset;
+};
+
+bool test_40_2 (const hw_reg_cached_ref<decltype (chip_regs::id)>& id)
+{
+  return id & 0x10;		// served from memory after the first read
+}
+
+//hw_reg_cached_ref<decltype (chip_regs::reset)> cached_reset;	// NG: compile time error, write-only
+
+// the capabilities are part of the register types, the fields inherit them.
+typedef hw_reg_caps_byte_writable uart_caps;
+
+struct uart_regs
+{
+  hw_reg_rw	<uint32_t, void, hw_reg_single_owner, uart_caps> lcr;
+  hw_reg_w	<uint32_t, void, hw_reg_single_owner, uart_caps> fifo_ctrl;
+};
+
+struct legacy_uart_regs
+{
+  hw_reg_rw	<uint32_t> lcr;			// full width accesses only
+};
+
+typedef hw_reg_field<decltype (uart_regs::lcr), 8, 8, uint8_t> uart_div;		// narrow store
+typedef hw_reg_field<decltype (uart_regs::lcr), 16, 16, uint16_t> uart_frac;		// narrow store
+typedef hw_reg_field<decltype (uart_regs::lcr), 4, 8, uint8_t> uart_misaligned;		// RMW
+typedef hw_reg_field<decltype (legacy_uart_regs::lcr), 8, 8, uint8_t> uart_div_full;	// RMW
+typedef hw_reg_field<decltype (uart_regs::fifo_ctrl), 0, 8, uint8_t> uart_fifo_thr;
+
+static_assert (uart_div::narrow_store && uart_frac::narrow_store, "narrow store expected");
+static_assert (!uart_misaligned::narrow_store && !uart_div_full::narrow_store, "RMW expected");
+
+void test_41 (uart_regs& r, uint8_t div)
+{
+  uart_div::set (r.lcr, div);		// single byte store, no read
+}
+
+void test_42 (legacy_uart_regs& r, uint8_t div)
+{
+  uart_div_full::set (r.lcr, div);	// full width read-modify-write
+}
+
+void test_43 (uart_regs& r, uint8_t thr)
+{
+  uart_fifo_thr::set (r.fifo_ctrl, thr);	// OK: narrow store does not read the write-only register
+}
+
+
 int main (void)
 {
   return 0;
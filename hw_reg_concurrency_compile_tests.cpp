@@ -0,0 +1,246 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register concurrency policy tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 -pthread hw_reg_concurrency_compile_tests.cpp
+
+Multiple threads update different bits of the same memory-backed registers.
+The resulting executable returns a non-zero exit code if an update got lost.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg.hpp"
+
+#include <thread>
+#include <vector>
+#include <memory>
+
+using namespace test_namespace;
+
+struct shared_regs
+{
+  hw_reg_rw	<uint32_t, void, hw_reg_atomic> enable;		// atomic RMW
+  hw_reg_rw	<uint32_t, void, hw_reg_lock_striped<>> route;	// RMW under a striped lock
+  hw_reg_rw	<uint32_t, void, hw_reg_atomic> count;
+  hw_reg_rw	<uint32_t> status;				// single owner
+};
+
+void test_00 (shared_regs& r)
+{
+  r.enable |= 0x10;		// lock or
+}
+
+void test_01 (shared_regs& r)
+{
+  r.enable <<= 1;		// compare-exchange loop
+}
+
+void test_02 (shared_regs& r)
+{
+  r.route &= ~0x10u;		// spinlock, volatile RMW, unlock
+}
+
+void test_03 (shared_regs& r)
+{
+  r.status |= 0x10;		// volatile RMW, no locking
+}
+
+void test_04 (shared_regs& r)
+{
+  r.enable.update (0xF0, 0x50);	// compare-exchange loop
+}
+
+// one 4 bit field per thread.
+template <unsigned Id> using enable_field = hw_reg_field<decltype (shared_regs::enable), Id * 4, 4>;
+template <unsigned Id> using route_field = hw_reg_field<decltype (shared_regs::route), Id * 4, 4>;
+
+// byte writable registers, the byte fields are set with narrow stores.
+struct narrow_regs
+{
+  hw_reg_rw	<uint32_t, void, hw_reg_lock_striped<>, hw_reg_caps_byte_writable> ctrl;
+  hw_reg_rw	<uint32_t, void, hw_reg_atomic, hw_reg_caps_byte_writable> mode;
+};
+
+template <typename Reg, unsigned Id> using byte_field = hw_reg_field<Reg, Id * 8, 8>;
+template <typename Reg, unsigned Id> using nibble_field = hw_reg_field<Reg, 16 + Id * 4, 4>;
+
+static_assert (byte_field<decltype (narrow_regs::ctrl), 1>::narrow_store
+	       && !nibble_field<decltype (narrow_regs::ctrl), 1>::narrow_store, "narrow store expected");
+
+void test_05 (narrow_regs& r)
+{
+  byte_field<decltype (narrow_regs::ctrl), 1>::set (r.ctrl, 0x5A);	// spinlock, byte store, unlock
+}
+
+static_assert (sizeof (shared_regs) == 4 * sizeof (uint32_t), "policies must not change the register layout");
+
+static const unsigned thread_count = 8;
+static const unsigned iterations = 100000;
+
+static void worker (shared_regs* r, unsigned id)
+{
+  const uint32_t bit = uint32_t (1) << id;
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    r->enable |= bit;
+    r->enable &= ~bit;
+    r->route |= bit << 8;
+    r->route &= ~(bit << 8);
+    r->count += 1;
+  }
+  r->enable |= bit;
+  r->route |= bit << 8;
+}
+
+template <unsigned Id> static void field_worker (shared_regs* r)
+{
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    enable_field<Id>::set (r->enable, i & 0xF);
+    route_field<Id>::set (r->route, ~i & 0xF);
+  }
+  enable_field<Id>::set (r->enable, Id + 1);
+  route_field<Id>::set (r->route, Id + 8);
+}
+
+static bool check_fields (void)
+{
+  shared_regs r;
+  *(&r.enable) = 0;
+  *(&r.route) = 0;
+
+  std::vector<std::thread> threads;
+  threads.emplace_back (field_worker<0>, &r);
+  threads.emplace_back (field_worker<1>, &r);
+  threads.emplace_back (field_worker<2>, &r);
+  threads.emplace_back (field_worker<3>, &r);
+  threads.emplace_back (field_worker<4>, &r);
+  threads.emplace_back (field_worker<5>, &r);
+  threads.emplace_back (field_worker<6>, &r);
+  threads.emplace_back (field_worker<7>, &r);
+  for (auto& t : threads)
+    t.join ();
+
+  // a lost field update leaves an intermediate value in one of the fields.
+  return r.enable == 0x87654321 && r.route == 0xFEDCBA98;
+}
+
+// threads 0 and 1 set the two low bytes with narrow stores, threads 2 to 5
+// set the four high nibbles with read-modify-writes of the whole register
+// until the byte threads are done.  a read-modify-write that is not ordered
+// with a narrow store writes back the old byte value.
+static bool mixed_stop;
+static bool mixed_lost;
+
+template <typename Reg, unsigned Id> static void mixed_worker (Reg* reg)
+{
+  typedef byte_field<Reg, Id % 2> bf;
+  typedef nibble_field<Reg, (Id - 2) % 4> nf;
+
+  if (Id < 2)
+  {
+    for (unsigned i = 0; i < iterations / 10; ++i)
+    {
+      bf::set (*reg, i & 0xFF);
+      for (unsigned j = 0; j < 8; ++j)
+	if (bf::get (*reg) != (i & 0xFF))
+	  __atomic_store_n (&mixed_lost, true, __ATOMIC_RELAXED);
+    }
+    bf::set (*reg, 0x10 * Id + 0x21);
+  }
+  else
+  {
+    for (unsigned i = 0; !__atomic_load_n (&mixed_stop, __ATOMIC_RELAXED); ++i)
+      nf::set (*reg, i & 0xF);
+    nf::set (*reg, Id + 2);
+  }
+}
+
+template <typename Reg> static bool check_mixed (Reg& reg)
+{
+  *(&reg) = 0;
+  mixed_stop = false;
+  mixed_lost = false;
+
+  std::vector<std::thread> threads;
+  threads.emplace_back (mixed_worker<Reg, 2>, std::addressof (reg));
+  threads.emplace_back (mixed_worker<Reg, 3>, std::addressof (reg));
+  threads.emplace_back (mixed_worker<Reg, 4>, std::addressof (reg));
+  threads.emplace_back (mixed_worker<Reg, 5>, std::addressof (reg));
+  std::thread b0 (mixed_worker<Reg, 0>, std::addressof (reg));
+  std::thread b1 (mixed_worker<Reg, 1>, std::addressof (reg));
+  b0.join ();
+  b1.join ();
+  __atomic_store_n (&mixed_stop, true, __ATOMIC_RELAXED);
+  for (auto& t : threads)
+    t.join ();
+
+  return !mixed_lost && reg == 0x76543121;
+}
+
+int main (void)
+{
+  shared_regs r;
+  *(&r.enable) = 0;
+  *(&r.route) = 0;
+  *(&r.count) = 0;
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < thread_count; ++i)
+    threads.emplace_back (worker, &r, i);
+  for (auto& t : threads)
+    t.join ();
+
+  const uint32_t all = (uint32_t (1) << thread_count) - 1;
+  if (r.enable != all)
+    return 1;
+  if (r.route != all << 8)
+    return 2;
+  if (r.count != thread_count * iterations)
+    return 3;
+  if (!check_fields ())
+    return 4;
+
+  narrow_regs n;
+  if (!check_mixed (n.ctrl))
+    return 5;
+  if (!check_mixed (n.mode))
+    return 6;
+  return 0;
+}
@@ -0,0 +1,126 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register fixed point field support
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+This header allows fixed_point value types in hw_reg_field descriptors.
+Many converters and synthesizers have registers that hold Q-format values,
+e.g. an 18-bit Q2.16 gain in bits 0..17 of a 32-bit register.
+
+The fractional bits of the field are the fractional bits of the fixed_point
+type.  The remaining field bits are the integral bits, which may be fewer
+than the integral bits of the fixed_point type:
+
+  typedef fixed_point<int32_t, 16, 16> gain_type;
+  typedef hw_reg_field<decltype (adc_regs::gain), 0, 18, gain_type> adc_gain;
+
+  gain_type g = adc_gain::get (regs.gain);	// sign extended Q2.16
+  adc_gain::set (regs.gain, g * corr);		// saturated to Q2.16
+
+Reading a signed field sign extends the field bits with a single shift pair
+and uses them as the raw value of the fixed_point.  Writing a value that does
+not fit into the field saturates it to the largest or smallest value that the
+field can represent.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_FIXED_POINT_HEADER_INCLUDED__
+#define __HWREG_FIXED_POINT_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <type_traits>
+
+#include "fixed_point.hpp"
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+#ifndef __FIXED_POINT_USE_NAMESPACE__
+#define __FIXED_POINT_USE_NAMESPACE__
+#define __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+template <typename T, unsigned I, unsigned F, bool W>
+struct hw_reg_field_traits<__FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W>>
+{
+  typedef __FIXED_POINT_USE_NAMESPACE__ fixed_point<T, I, F, W> value_type;
+  typedef typename std::conditional<std::is_signed<T>::value, intmax_t, uintmax_t>::type wide_type;
+
+  static constexpr bool is_signed = std::is_signed<T>::value;
+
+  template <typename R> static constexpr value_type from_raw (R raw) noexcept
+  {
+    return value_type (static_cast<T> (raw), __FIXED_POINT_USE_NAMESPACE__ FIXED_POINT_RAW);
+  }
+
+  template <typename R, unsigned Width> static constexpr R to_raw (const value_type& val) noexcept
+  {
+    return static_cast<R> (hw_reg_field_saturate<Width> (static_cast<wide_type> (val.raw ())));
+  }
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#undef __FIXED_POINT_USE_NAMESPACE__
+#undef __FIXED_POINT_USE_NAMESPACE_DO_UNDEF_AFTER__
+#endif
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_FIXED_POINT_HEADER_INCLUDED__
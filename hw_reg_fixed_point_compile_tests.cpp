@@ -0,0 +1,148 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register fixed point field tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_fixed_point_compile_tests.cpp
+
+The fields are accessed in ordinary memory register blocks.  The resulting
+executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_fixed_point.hpp"
+
+using namespace test_namespace;
+
+typedef fixed_point<int32_t, 16, 16> fxpt_16_16;
+typedef fixed_point<uint16_t, 4, 12> fxptu_4_12;
+
+struct adc_regs
+{
+  hw_reg_rw	<uint32_t> gain;	// Q2.16 in bits 0..17, enable in bit 31
+  hw_reg_rw	<uint32_t> offset;	// Q1.7 in bits 8..15
+  hw_reg_w	<uint32_t> pll;		// unsigned Q4.12 in bits 16..31
+};
+
+typedef hw_reg_field<decltype (adc_regs::gain), 0, 18, fxpt_16_16> adc_gain;
+typedef hw_reg_field<decltype (adc_regs::gain), 31, 1> adc_enable;
+typedef hw_reg_field<decltype (adc_regs::offset), 8, 8, fixed_point<int16_t, 9, 7>> adc_offset;
+typedef hw_reg_field<decltype (adc_regs::offset), 0, 4, int8_t> adc_trim;
+typedef hw_reg_field<decltype (adc_regs::pll), 16, 16, fxptu_4_12> pll_ratio;
+
+fxpt_16_16 test_00 (adc_regs& r)
+{
+  return adc_gain::get (r.gain);	// shift pair, no conversion
+}
+
+void test_01 (adc_regs& r, fxpt_16_16 g)
+{
+  adc_gain::set (r.gain, g);		// saturate + read-modify-write
+}
+
+void test_02 (adc_regs& r, fxptu_4_12 v)
+{
+  pll_ratio::write (r.pll, v);		// write-only register: plain write
+//pll_ratio::set (r.pll, v);		// NG: compile time error, write-only register
+}
+
+static_assert (adc_gain::mask == 0x0003FFFF, "unexpected field mask");
+static_assert (adc_gain::decode (0x00020000).raw () == -0x20000, "sign extension failed");
+static_assert (adc_gain::decode (0x80010000).raw () == 0x10000, "unexpected field value");
+static_assert (adc_gain::encode (fxpt_16_16 (4)) == 0x0001FFFF, "saturation failed");
+
+static bool check_gain (void)
+{
+  adc_regs r;
+  *(&r.gain) = 0x80000000;
+
+  adc_gain::set (r.gain, fxpt_16_16 (1.5f));
+  if (*(&r.gain) != (0x80000000 | 0x18000) || adc_gain::get (r.gain) != fxpt_16_16 (1.5f))
+    return false;
+
+  adc_gain::set (r.gain, fxpt_16_16 (-2));
+  if (*(&r.gain) != (0x80000000 | 0x20000) || adc_gain::get (r.gain) != fxpt_16_16 (-2))
+    return false;
+
+  // out of range for Q2.16, saturates to the largest / smallest value
+  adc_gain::set (r.gain, fxpt_16_16 (5));
+  if (adc_gain::get (r.gain).raw () != 0x1FFFF)
+    return false;
+
+  adc_gain::set (r.gain, fxpt_16_16 (-7.25f));
+  if (adc_gain::get (r.gain) != fxpt_16_16 (-2))
+    return false;
+
+  return adc_enable::get (r.gain) == 1;
+}
+
+static bool check_offset (void)
+{
+  adc_regs r;
+  *(&r.offset) = 0xFFFF000F;
+
+  adc_offset::set (r.offset, fixed_point<int16_t, 9, 7> (-0.5f));
+  if (*(&r.offset) != 0xFFFFC00F || adc_offset::get (r.offset) != fixed_point<int16_t, 9, 7> (-0.5f))
+    return false;
+
+  if (adc_trim::get (r.offset) != -1)
+    return false;
+
+  adc_trim::set (r.offset, int8_t (5));
+  return *(&r.offset) == 0xFFFFC005;
+}
+
+static bool check_unsigned (void)
+{
+  adc_regs r;
+  *(&r.pll) = 0xFFFFFFFF;
+
+  pll_ratio::write (r.pll, fxptu_4_12 (2.25f));
+  return *(&r.pll) == 0x24000000;
+}
+
+int main (void)
+{
+  if (!check_gain ())
+    return 1;
+  if (!check_offset ())
+    return 2;
+  if (!check_unsigned ())
+    return 3;
+  return 0;
+}
@@ -0,0 +1,267 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register host arena C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The host arena allows running code that uses constant address registers on
+a host machine, e.g. for unit tests, profiling and fuzzing of firmware code
+on a Linux PC.  It is enabled by defining __HW_REG_ENABLE_HOST_ARENA__ before
+including hw_reg.hpp.  Without the macro the register addresses are used as
+they are and nothing of this header is used.
+
+  #define __HW_REG_ENABLE_HOST_ARENA__
+  #include "hw_reg.hpp"
+
+  static hw_reg_rw<uint32_t, const_addr<0xA0000000>> CTRL;
+
+  hw_reg_host_arena::store<uint32_t> (0xA0000000, 0x55);	// device state
+  CTRL |= 1;							// host memory
+  assert (hw_reg_host_arena::load<uint32_t> (0xA0000000) == (0x55 | 1));
+
+Every const_addr register access is translated to a host address through a
+small table of regions.  A region is created when an address is accessed for
+the first time.  It covers the __HW_REG_HOST_ARENA_GRANULE__ (default 64 KiB)
+aligned block around the address.  Larger regions can be created up front
+with map.
+
+The memory of a region is reserved with mmap, preferably at the device
+address itself.  If that works, the translation is the identity and absolute
+device addresses that are used elsewhere, e.g. with hw_init_mmio_bus, refer
+to the same memory.  Otherwise, e.g. for addresses below the kernel's
+mmap_min_addr, the region is placed anywhere and the translation adds an
+offset.  The region at address 0 is always placed elsewhere, so that null
+pointer dereferences of the host code still fault.
+
+Region memory is zero initialized.  At most __HW_REG_HOST_ARENA_REGIONS__
+(default 64) regions can be created.  If the table is full or mmap fails,
+the program is aborted.  Translations are lock-free, creating regions is
+serialized with a spin lock.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_HOST_ARENA_HEADER_INCLUDED__
+#define __HWREG_HOST_ARENA_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#ifndef __HW_REG_HOST_ARENA_REGIONS__
+#define __HW_REG_HOST_ARENA_REGIONS__ 64
+#endif
+
+#ifndef __HW_REG_HOST_ARENA_GRANULE__
+#define __HW_REG_HOST_ARENA_GRANULE__ 0x10000
+#endif
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+struct hw_reg_host_region
+{
+  uintptr_t base;		// device address
+  uintptr_t size;
+  uintptr_t offset;		// host address - device address
+};
+
+// the arena state.  a class template is used to get zero initialized static
+// storage in a header without guard variables.
+template <typename Dummy = void> class hw_reg_host_arena_t
+{
+public:
+  static constexpr std::size_t max_regions = __HW_REG_HOST_ARENA_REGIONS__;
+  static constexpr uintptr_t granule = __HW_REG_HOST_ARENA_GRANULE__;
+
+  static_assert ((granule & (granule - 1)) == 0, "__HW_REG_HOST_ARENA_GRANULE__ must be a power of two");
+
+  // host address of a device address.
+  static uintptr_t translate (uintptr_t addr) noexcept
+  {
+    const std::size_t n = __atomic_load_n (&__count, __ATOMIC_ACQUIRE);
+    for (std::size_t i = 0; i < n; ++i)
+      if (addr - __regions[i].base < __regions[i].size)
+	return addr + __regions[i].offset;
+
+    return create (addr & ~(granule - 1), granule, addr) + (addr & (granule - 1));
+  }
+
+  template <typename T> static T* host_address (uintptr_t addr) noexcept
+  {
+    return reinterpret_cast<T*> (translate (addr));
+  }
+
+  // access the memory behind a device address, e.g. to set up or check the
+  // device state in a test.
+  template <typename T> static T load (uintptr_t addr) noexcept
+  {
+    return *reinterpret_cast<volatile T*> (translate (addr));
+  }
+
+  template <typename T> static void store (uintptr_t addr, const T& value) noexcept
+  {
+    *reinterpret_cast<volatile T*> (translate (addr)) = value;
+  }
+
+  // create a region for the device address range [base, base + size) before
+  // it is accessed.  the range is extended to granule boundaries and must not
+  // overlap existing regions.  returns the host address of base, or nullptr
+  // if the range overlaps an existing region.
+  static void* map (uintptr_t base, std::size_t size) noexcept
+  {
+    const uintptr_t b = base & ~(granule - 1);
+    const uintptr_t s = (base + size - b + granule - 1) & ~(granule - 1);
+    const uintptr_t p = create (b, s, base, true);
+    return p == 0 ? nullptr : reinterpret_cast<void*> (p + (base - b));
+  }
+
+  // true if the device address is backed by host memory at the same address.
+  static bool identity (uintptr_t addr) noexcept { return translate (addr) == addr; }
+
+  static std::size_t region_count (void) noexcept { return __atomic_load_n (&__count, __ATOMIC_ACQUIRE); }
+  static const hw_reg_host_region& region (std::size_t i) noexcept { return __regions[i]; }
+
+private:
+  // returns the host address of base.  addr is only used for the error
+  // messages.  if the range overlaps an existing region, the host address of
+  // base in that region is returned, or 0 if exclusive is true.
+  static uintptr_t create (uintptr_t base, uintptr_t size, uintptr_t addr, bool exclusive = false) noexcept
+  {
+    while (__atomic_test_and_set (&__lock, __ATOMIC_ACQUIRE))
+      ;
+
+    // another thread might have created the region in the meantime.  regions
+    // are granule aligned, thus a granule overlaps a region only if the
+    // region contains it.
+    for (std::size_t i = 0; i < __count; ++i)
+      if (base - __regions[i].base < __regions[i].size || __regions[i].base - base < size)
+      {
+	const uintptr_t r = exclusive ? 0 : base + __regions[i].offset;
+	__atomic_clear (&__lock, __ATOMIC_RELEASE);
+	return r;
+      }
+
+    if (__count == max_regions)
+      fail ("region table full", addr);
+
+    hw_reg_host_region& r = __regions[__count];
+    r.base = base;
+    r.size = size;
+    r.offset = reserve (base, size, addr) - base;
+
+    __atomic_store_n (&__count, __count + 1, __ATOMIC_RELEASE);
+    __atomic_clear (&__lock, __ATOMIC_RELEASE);
+    return base + r.offset;
+  }
+
+  // try to map at the device address first, anywhere else otherwise.  the
+  // region at address 0 is never mapped at its own address, which would hide
+  // null pointer dereferences of the host code.
+  static uintptr_t reserve (uintptr_t base, uintptr_t size, uintptr_t addr) noexcept
+  {
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    void* p = MAP_FAILED;
+    if (base != 0)
+#ifdef MAP_FIXED_NOREPLACE
+      p = mmap (reinterpret_cast<void*> (base), size, prot, flags | MAP_FIXED_NOREPLACE, -1, 0);
+#else
+      p = mmap (reinterpret_cast<void*> (base), size, prot, flags, -1, 0);
+#endif
+
+    if (p != MAP_FAILED && reinterpret_cast<uintptr_t> (p) != base)
+    {
+      munmap (p, size);
+      p = MAP_FAILED;
+    }
+
+    if (p == MAP_FAILED)
+      p = mmap (nullptr, size, prot, flags, -1, 0);
+
+    if (p == MAP_FAILED)
+      fail ("mmap failed", addr);
+
+    return reinterpret_cast<uintptr_t> (p);
+  }
+
+  [[noreturn]] static void fail (const char* msg, uintptr_t addr) noexcept
+  {
+    std::fprintf (stderr, "hw_reg_host_arena: %s for register address 0x%llx\n",
+		  msg, (unsigned long long)addr);
+    std::abort ();
+  }
+
+  static hw_reg_host_region __regions[max_regions];
+  static std::size_t __count;
+  static bool __lock;
+};
+
+template <typename Dummy> hw_reg_host_region hw_reg_host_arena_t<Dummy>::__regions[hw_reg_host_arena_t<Dummy>::max_regions];
+template <typename Dummy> std::size_t hw_reg_host_arena_t<Dummy>::__count;
+template <typename Dummy> bool hw_reg_host_arena_t<Dummy>::__lock;
+
+typedef hw_reg_host_arena_t<> hw_reg_host_arena;
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_HOST_ARENA_HEADER_INCLUDED__
@@ -0,0 +1,214 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register host arena tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_host_arena_compile_tests.cpp
+
+The constant address registers below are backed by host memory.  The
+resulting executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#define __HW_REG_ENABLE_HOST_ARENA__
+#include "hw_reg.hpp"
+#include "hw_reg_init_seq.hpp"
+
+using namespace test_namespace;
+
+// a typical firmware register set at absolute addresses.
+static hw_reg_rw<uint32_t, const_addr<0xA0000000>> CTRL;
+static hw_reg_r<uint32_t, const_addr<0xA0000004>> STATUS;
+static hw_reg_w<uint32_t, const_addr<0xA0000008>> DATA;
+
+// the null page is never mapped, this one is translated.
+static hw_reg_rw<uint16_t, const_addr<0x1002>> LOW_REG;
+
+struct dma_channel
+{
+  hw_reg_rw<uint32_t> ctrl;
+  hw_reg_rw<uint32_t> src;
+};
+
+static constexpr hw_reg_array<dma_channel, 8, 0x40, const_addr<0xA0100000>> DMA_CH = { };
+
+typedef hw_reg_field<hw_reg_rw<uint32_t, const_addr<0xA0000000>>, 4, 3> ctrl_mode;
+
+// table lookup in front of the volatile load.
+uint32_t test_00 (void)
+{
+  return STATUS;
+}
+
+static bool check_access (void)
+{
+  hw_reg_host_arena::store<uint32_t> (0xA0000004, 0x80);
+  if (STATUS != 0x80)
+    return false;
+
+  CTRL = 0x10;
+  CTRL |= 1;
+  ctrl_mode::set (CTRL, 5);
+  if (hw_reg_host_arena::load<uint32_t> (0xA0000000) != 0x51)
+    return false;
+
+  DATA = 0x1234;
+  if (hw_reg_host_arena::load<uint32_t> (0xA0000008) != 0x1234)
+    return false;
+
+  // the same region serves all three registers.
+  if (&CTRL + 1 != &STATUS)
+    return false;
+
+  LOW_REG = 0xBEEF;
+  if (hw_reg_host_arena::load<uint16_t> (0x1002) != 0xBEEF || hw_reg_host_arena::identity (0x1002))
+    return false;
+
+  // mapped at the device address, plain pointers work as well.
+  if (hw_reg_host_arena::identity (0xA0000000)
+      && *reinterpret_cast<volatile uint32_t*> (0xA0000000) != 0x51)
+    return false;
+
+  return true;
+}
+
+static bool check_array (void)
+{
+  DMA_CH[3].src = 0x1000;
+  DMA_CH.at<5> ().ctrl |= 1;
+
+  return hw_reg_host_arena::load<uint32_t> (0xA01000C4) == 0x1000
+	 && hw_reg_host_arena::load<uint32_t> (0xA0100140) == 1
+	 && DMA_CH[5].ctrl == 1;
+}
+
+static bool check_map (void)
+{
+  // a large region created up front, not aligned to the granule.
+  const std::size_t n = hw_reg_host_arena::region_count ();
+  uint32_t* p = static_cast<uint32_t*> (hw_reg_host_arena::map (0xB0008000, 0x30000));
+  if (p == nullptr || hw_reg_host_arena::region_count () != n + 1)
+    return false;
+
+  p[0x4000] = 42;
+  if (hw_reg_host_arena::load<uint32_t> (0xB0018000) != 42)
+    return false;
+
+  // no new region for addresses inside it.
+  if (hw_reg_host_arena::region_count () != n + 1)
+    return false;
+
+  // ranges that overlap the region or a region created on first access
+  // are rejected.
+  hw_reg_host_arena::store<uint32_t> (0xB0100000, 1);
+  return hw_reg_host_arena::map (0xB0030000, 0x20000) == nullptr
+	 && hw_reg_host_arena::map (0xB00F0000, 0x30000) == nullptr
+	 && hw_reg_host_arena::region_count () == n + 2;
+}
+
+static constexpr hw_reg_ro_cached<uint32_t, const_addr<0xA0000010>> CHIP_ID;
+
+struct chip_regs
+{
+  hw_reg_r	<uint32_t> id;
+  hw_reg_r	<uint32_t> rev;
+};
+
+static bool check_cached (void)
+{
+  hw_reg_host_arena::store<uint32_t> (0xA0000010, 0x1234);
+  if (CHIP_ID != 0x1234)
+    return false;
+
+  // served from memory until invalidated, e.g. after a device reset.
+  hw_reg_host_arena::store<uint32_t> (0xA0000010, 0x5678);
+  if (CHIP_ID.read () != 0x1234)
+    return false;
+  CHIP_ID.invalidate ();
+  if (CHIP_ID != 0x5678)
+    return false;
+
+  // register block members are cached per instance.
+  chip_regs dev[2];
+  *(&dev[0].id) = 1;
+  *(&dev[1].id) = 2;
+  hw_reg_cached_ref<decltype (chip_regs::id)> id0 (dev[0].id);
+  hw_reg_cached_ref<decltype (chip_regs::id)> id1 (dev[1].id);
+  if (id0.probe () != 1 || id1 != 2)
+    return false;
+
+  *(&dev[0].id) = 3;
+  if (id0 != 1)
+    return false;
+  id0.invalidate ();
+  return id0 == 3 && id1 == 2;
+}
+
+// absolute addresses in the translated region at address 0.
+static hw_reg_rw<uint32_t, const_addr<0x2000>> PLL_CTRL;
+static hw_reg_r<uint32_t, const_addr<0x2004>> PLL_STAT;
+
+static constexpr hw_init_op pll_init[] =
+{
+  hw_init_write (PLL_CTRL, 0x77),
+  hw_init_modify (PLL_CTRL, 0xF0, 0x30),
+  hw_init_poll (PLL_STAT, 0x1, 0x1, 10)
+};
+
+static bool check_init_seq (void)
+{
+  // the bus translates the addresses like the registers do.
+  hw_reg_host_arena::store<uint32_t> (0x2004, 1);
+  hw_init_mmio_bus bus (0, [] (uint32_t) { });
+  return hw_init_seq_run (pll_init, bus) == hw_init_seq_size (pll_init)
+	 && PLL_CTRL == 0x37 && !hw_reg_host_arena::identity (0x2000);
+}
+
+int main (void)
+{
+  if (!check_access ())
+    return 1;
+  if (!check_array ())
+    return 2;
+  if (!check_map ())
+    return 3;
+  if (!check_cached ())
+    return 4;
+  if (!check_init_seq ())
+    return 5;
+  return 0;
+}
@@ -0,0 +1,434 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register initialization sequence C++ classes
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+Device bring-up code usually consists of long lists of register writes,
+read-modify-writes, delays and status polls.  Written as individual hw_reg
+assignments, each of them becomes a separate code sequence.  This file allows
+describing such sequences as constexpr tables, which are executed by a
+compact interpreter loop.  The tables can be placed in read-only memory and
+are checked at compile time.
+
+Each table entry is one of the following operations on a 32-bit register:
+
+  hw_init_write (reg, value)			reg = value
+  hw_init_modify (reg, mask, value)		reg = (reg & ~mask) | value
+  hw_init_poll (reg, mask, value, limit)	wait until (reg & mask) == value
+  hw_init_delay (microseconds)			busy wait
+
+The register can be a constant address hw_reg object, or an address offset.
+Offsets are added to the base address of the bus that executes the sequence,
+which is useful for register block structs (together with offsetof):
+
+  static constexpr hw_reg_rw<uint32_t, const_addr<0xA0001000>> PLL_CTRL;
+  static constexpr hw_reg_r<uint32_t, const_addr<0xA0001004>> PLL_STAT;
+
+  static constexpr hw_init_op pll_init[] =
+  {
+    hw_init_write (PLL_CTRL, 0x00000000),
+    hw_init_modify (PLL_CTRL, 0x0000FF00, 0x00002A00),
+    hw_init_modify (PLL_CTRL, 0x00000001, 0x00000001),
+    hw_init_poll (PLL_STAT, 0x00000001, 0x00000001, 1000),
+    hw_init_delay (10)
+  };
+
+  static_assert (hw_init_seq_valid (pll_init), "invalid PLL init sequence");
+
+  hw_init_mmio_bus bus;
+  if (hw_init_seq_run (pll_init, bus) != hw_init_seq_size (pll_init))
+    ... // poll timed out
+
+The interpreter accesses the registers through a bus object.  Besides the
+memory mapped bus hw_init_mmio_bus, hw_init_seq_recorder can be used as a bus.
+If the host arena is enabled (see hw_reg_host_arena.hpp), hw_init_mmio_bus
+translates device addresses through the arena, so sequences reach the same
+memory as the constant address registers.
+It records all operations into a new sequence and optionally forwards them
+to another bus.  This way bring-up code can be run against a simulated,
+memory-backed register block once, and the recorded sequence can be printed
+as a constexpr table and replayed later.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_INIT_SEQ_HEADER_INCLUDED__
+#define __HWREG_INIT_SEQ_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <chrono>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+enum hw_init_op_kind : uint8_t
+{
+  HW_INIT_WRITE,
+  HW_INIT_MODIFY,
+  HW_INIT_POLL,
+  HW_INIT_DELAY
+};
+
+struct hw_init_op
+{
+  uintptr_t addr;		// register address or offset
+  uint32_t value;
+  uint32_t mask;
+  uint32_t arg;			// delay in microseconds or poll limit (0 = no limit)
+  hw_init_op_kind kind;
+};
+
+// address of a constant address register.  not defined for other types,
+// which removes the register based operation constructors from overload
+// resolution.
+template <typename Reg, typename Enable = void> struct hw_init_reg_addr { };
+
+template <typename Reg>
+struct hw_init_reg_addr<Reg, typename std::enable_if<!std::is_void<typename Reg::address_type>::value>::type>
+{
+  static_assert (sizeof (typename Reg::base_type) == sizeof (uint32_t)
+		 , "hw_init_op supports 32-bit registers only");
+  static constexpr uintptr_t value = Reg::address_type::value;
+};
+
+constexpr hw_init_op hw_init_write (uintptr_t addr, uint32_t value) noexcept
+{
+  return hw_init_op { addr, value, 0xFFFFFFFF, 0, HW_INIT_WRITE };
+}
+
+constexpr hw_init_op hw_init_modify (uintptr_t addr, uint32_t mask, uint32_t value) noexcept
+{
+  return hw_init_op { addr, value, mask, 0, HW_INIT_MODIFY };
+}
+
+constexpr hw_init_op hw_init_poll (uintptr_t addr, uint32_t mask, uint32_t value, uint32_t limit = 0) noexcept
+{
+  return hw_init_op { addr, value, mask, limit, HW_INIT_POLL };
+}
+
+constexpr hw_init_op hw_init_delay (uint32_t microseconds) noexcept
+{
+  return hw_init_op { 0, 0, 0, microseconds, HW_INIT_DELAY };
+}
+
+template <typename Reg>
+constexpr auto hw_init_write (const Reg&, uint32_t value) noexcept
+  -> decltype (hw_init_reg_addr<Reg>::value, hw_init_op ())
+{
+  static_assert (Reg::writable, "hw_init_write register is not writable");
+  return hw_init_write (hw_init_reg_addr<Reg>::value, value);
+}
+
+template <typename Reg>
+constexpr auto hw_init_modify (const Reg&, uint32_t mask, uint32_t value) noexcept
+  -> decltype (hw_init_reg_addr<Reg>::value, hw_init_op ())
+{
+  static_assert (Reg::readable && Reg::writable, "hw_init_modify register must be readable and writable");
+  return hw_init_modify (hw_init_reg_addr<Reg>::value, mask, value);
+}
+
+template <typename Reg>
+constexpr auto hw_init_poll (const Reg&, uint32_t mask, uint32_t value, uint32_t limit = 0) noexcept
+  -> decltype (hw_init_reg_addr<Reg>::value, hw_init_op ())
+{
+  static_assert (Reg::readable, "hw_init_poll register is not readable");
+  return hw_init_poll (hw_init_reg_addr<Reg>::value, mask, value, limit);
+}
+
+// compile-time checks of operations and sequences.
+constexpr bool hw_init_op_valid (const hw_init_op& op) noexcept
+{
+  return op.kind == HW_INIT_DELAY
+	 ? op.arg > 0
+	 : (op.kind == HW_INIT_WRITE || op.kind == HW_INIT_MODIFY || op.kind == HW_INIT_POLL)
+	   && op.addr % sizeof (uint32_t) == 0
+	   && (op.value & ~op.mask) == 0
+	   && op.mask != 0;
+}
+
+// split the range in halves to keep the constexpr recursion depth low for
+// long sequences.
+constexpr bool hw_init_seq_valid (const hw_init_op* seq, std::size_t begin, std::size_t end) noexcept
+{
+  return end - begin == 0 ? true
+	 : end - begin == 1 ? hw_init_op_valid (seq[begin])
+	 : hw_init_seq_valid (seq, begin, begin + (end - begin) / 2)
+	   && hw_init_seq_valid (seq, begin + (end - begin) / 2, end);
+}
+
+template <std::size_t N>
+constexpr bool hw_init_seq_valid (const hw_init_op (&seq)[N]) noexcept
+{
+  return hw_init_seq_valid (seq, 0, N);
+}
+
+template <std::size_t N>
+constexpr std::size_t hw_init_seq_size (const hw_init_op (&)[N]) noexcept
+{
+  return N;
+}
+
+
+// busy wait with the standard steady clock.
+inline void hw_init_busy_delay (uint32_t microseconds)
+{
+  const std::chrono::steady_clock::time_point end
+    = std::chrono::steady_clock::now () + std::chrono::microseconds (microseconds);
+  while (std::chrono::steady_clock::now () < end)
+    ;
+}
+
+// bus that executes the operations as volatile memory accesses.
+// addresses are added to the base address.
+class hw_init_mmio_bus
+{
+public:
+  explicit hw_init_mmio_bus (uintptr_t base = 0,
+			     void (*delay_func)(uint32_t) = hw_init_busy_delay) noexcept
+    : __base (base), __device (true), __delay (delay_func)
+  { }
+
+  template <typename Block>
+  explicit hw_init_mmio_bus (Block& block, void (*delay_func)(uint32_t) = hw_init_busy_delay) noexcept
+    : __base (reinterpret_cast<uintptr_t> (&reinterpret_cast<unsigned char&> (block))),
+      __device (false), __delay (delay_func)
+  { }
+
+  uint32_t read (uintptr_t addr) const { return *reg (addr); }
+  void write (uintptr_t addr, uint32_t value) { *reg (addr) = value; }
+
+  void modify (uintptr_t addr, uint32_t mask, uint32_t value)
+  {
+    volatile uint32_t* r = reg (addr);
+    *r = (*r & ~mask) | value;
+  }
+
+  bool poll (uintptr_t addr, uint32_t mask, uint32_t value, uint32_t limit)
+  {
+    volatile uint32_t* r = reg (addr);
+    for (uint32_t i = 0; limit == 0 || i < limit; ++i)
+      if ((*r & mask) == value)
+	return true;
+    return false;
+  }
+
+  void delay (uint32_t microseconds) { __delay (microseconds); }
+
+private:
+  // device addresses are translated like constant hw_reg addresses, block
+  // addresses are host addresses already.
+  volatile uint32_t* reg (uintptr_t addr) const
+  {
+#ifdef __HW_REG_ENABLE_HOST_ARENA__
+    if (__device)
+      return reinterpret_cast<volatile uint32_t*> (hw_reg_host_arena::translate (__base + addr));
+#endif
+    return reinterpret_cast<volatile uint32_t*> (__base + addr);
+  }
+
+  const uintptr_t __base;
+  const bool __device;		// __base is a device address
+  void (* const __delay)(uint32_t);
+};
+
+
+// execute the operations on the bus.  returns the index of the poll
+// operation that hit its limit, or n if all operations have been executed.
+template <typename Bus>
+std::size_t hw_init_seq_run (const hw_init_op* seq, std::size_t n, Bus& bus)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const hw_init_op& op = seq[i];
+    switch (op.kind)
+    {
+      case HW_INIT_WRITE:
+	bus.write (op.addr, op.value);
+	break;
+
+      case HW_INIT_MODIFY:
+	bus.modify (op.addr, op.mask, op.value);
+	break;
+
+      case HW_INIT_POLL:
+	if (!bus.poll (op.addr, op.mask, op.value, op.arg))
+	  return i;
+	break;
+
+      case HW_INIT_DELAY:
+	bus.delay (op.arg);
+	break;
+    }
+  }
+  return n;
+}
+
+template <typename Bus, std::size_t N>
+std::size_t hw_init_seq_run (const hw_init_op (&seq)[N], Bus& bus)
+{
+  return hw_init_seq_run (seq, N, bus);
+}
+
+
+// discards all operations.  used as the default downstream bus of the
+// recorder.
+struct hw_init_null_bus
+{
+  uint32_t read (uintptr_t) const { return 0; }
+  void write (uintptr_t, uint32_t) { }
+  void modify (uintptr_t, uint32_t, uint32_t) { }
+  bool poll (uintptr_t, uint32_t, uint32_t, uint32_t) { return true; }
+  void delay (uint32_t) { }
+};
+
+// bus that records all operations and forwards them to the bus Next.
+template <typename Next = hw_init_null_bus> class hw_init_seq_recorder
+{
+public:
+  hw_init_seq_recorder (void) : __next (nullptr) { }
+  explicit hw_init_seq_recorder (Next& next) : __next (&next) { }
+
+  uint32_t read (uintptr_t addr) const { return __next ? __next->read (addr) : 0; }
+
+  void write (uintptr_t addr, uint32_t value)
+  {
+    __ops.push_back (hw_init_write (addr, value));
+    if (__next)
+      __next->write (addr, value);
+  }
+
+  void modify (uintptr_t addr, uint32_t mask, uint32_t value)
+  {
+    __ops.push_back (hw_init_modify (addr, mask, value));
+    if (__next)
+      __next->modify (addr, mask, value);
+  }
+
+  bool poll (uintptr_t addr, uint32_t mask, uint32_t value, uint32_t limit)
+  {
+    __ops.push_back (hw_init_poll (addr, mask, value, limit));
+    return __next ? __next->poll (addr, mask, value, limit) : true;
+  }
+
+  void delay (uint32_t microseconds)
+  {
+    __ops.push_back (hw_init_delay (microseconds));
+    if (__next)
+      __next->delay (microseconds);
+  }
+
+  const std::vector<hw_init_op>& ops (void) const noexcept { return __ops; }
+  void clear (void) noexcept { __ops.clear (); }
+
+  // replay the recorded sequence on another bus.
+  template <typename Bus> std::size_t replay (Bus& bus) const
+  {
+    return hw_init_seq_run (__ops.data (), __ops.size (), bus);
+  }
+
+  // print the recorded sequence as a constexpr table definition.
+  void print (std::ostream& out, const char* name) const
+  {
+    const std::ios_base::fmtflags flags = out.flags ();
+    const char fill = out.fill ();
+    out << "static constexpr hw_init_op " << name << "[] =\n{\n" << std::hex << std::setfill ('0');
+
+    for (std::size_t i = 0; i < __ops.size (); ++i)
+    {
+      const hw_init_op& op = __ops[i];
+      out << "  ";
+      switch (op.kind)
+      {
+	case HW_INIT_WRITE:
+	  out << "hw_init_write (0x" << op.addr << ", 0x" << std::setw (8) << op.value << ")";
+	  break;
+	case HW_INIT_MODIFY:
+	  out << "hw_init_modify (0x" << op.addr << ", 0x" << std::setw (8) << op.mask
+	      << ", 0x" << std::setw (8) << op.value << ")";
+	  break;
+	case HW_INIT_POLL:
+	  out << "hw_init_poll (0x" << op.addr << ", 0x" << std::setw (8) << op.mask
+	      << ", 0x" << std::setw (8) << op.value << ", " << std::dec << op.arg << std::hex << ")";
+	  break;
+	case HW_INIT_DELAY:
+	  out << "hw_init_delay (" << std::dec << op.arg << std::hex << ")";
+	  break;
+      }
+      out << (i + 1 < __ops.size () ? ",\n" : "\n");
+    }
+
+    out << "};\n";
+    out.flags (flags);
+    out.fill (fill);
+  }
+
+private:
+  Next* __next;
+  std::vector<hw_init_op> __ops;
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_INIT_SEQ_HEADER_INCLUDED__
@@ -0,0 +1,176 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register initialization sequence compile-time tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_init_seq_compile_tests.cpp
+
+The sequences are replayed on ordinary memory register blocks.  The resulting
+executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_init_seq.hpp"
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+using namespace test_namespace;
+
+struct pll_regs
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_r	<uint32_t> status;
+  hw_reg_rw	<uint32_t> div[4];
+};
+
+static constexpr hw_reg_rw<uint32_t, const_addr<0xA0001000>> PLL_CTRL;
+static constexpr hw_reg_r<uint32_t, const_addr<0xA0001004>> PLL_STAT;
+static constexpr hw_reg_rw<uint16_t, const_addr<0xA0001008>> PLL_CFG16;
+static constexpr hw_reg_w<uint32_t, const_addr<0xA000100C>> PLL_APPLY;
+
+static constexpr hw_init_op g_seq_0[] =
+{
+  hw_init_write (PLL_CTRL, 0x00000000),
+  hw_init_modify (PLL_CTRL, 0x0000FF00, 0x00002A00),
+  hw_init_poll (PLL_STAT, 0x00000001, 0x00000001, 1000),
+  hw_init_delay (10)
+};
+
+static_assert (hw_init_seq_valid (g_seq_0), "valid sequence");
+static_assert (g_seq_0[1].addr == 0xA0001000, "register address");
+
+// sequence on a register block, addresses are offsets
+static constexpr hw_init_op g_seq_1[] =
+{
+  hw_init_write (offsetof (pll_regs, div[0]), 1),
+  hw_init_write (offsetof (pll_regs, div[1]), 2),
+  hw_init_modify (offsetof (pll_regs, ctrl), 0x3, 0x1),
+  hw_init_poll (offsetof (pll_regs, status), 0x1, 0x1, 10)
+};
+
+static_assert (hw_init_seq_valid (g_seq_1), "valid sequence");
+
+// NG: value bits outside of mask
+static constexpr hw_init_op g_seq_2[] = { hw_init_modify (PLL_CTRL, 0x00FF, 0x0100) };
+static_assert (!hw_init_seq_valid (g_seq_2), "invalid sequence");
+
+// NG: misaligned register address
+static constexpr hw_init_op g_seq_3[] = { hw_init_write (0x0002, 1) };
+static_assert (!hw_init_seq_valid (g_seq_3), "invalid sequence");
+
+// NG: compile time error, only 32-bit registers are supported
+// static constexpr hw_init_op g_seq_4[] = { hw_init_write (PLL_CFG16, 1) };
+
+// NG: compile time error, read-only register
+// static constexpr hw_init_op g_seq_5[] = { hw_init_write (PLL_STAT, 1) };
+// static constexpr hw_init_op g_seq_6[] = { hw_init_modify (PLL_STAT, 0x1, 0x1) };
+
+// NG: compile time error, write-only register
+// static constexpr hw_init_op g_seq_7[] = { hw_init_poll (PLL_APPLY, 0x1, 0x1) };
+// static constexpr hw_init_op g_seq_8[] = { hw_init_modify (PLL_APPLY, 0x1, 0x1) };
+
+static constexpr hw_init_op g_seq_9[] = { hw_init_write (PLL_APPLY, 1), hw_init_poll (PLL_STAT, 0x1, 0x1) };
+static_assert (hw_init_seq_valid (g_seq_9), "valid sequence");
+
+std::size_t test_00 (void)
+{
+  hw_init_mmio_bus bus;
+  return hw_init_seq_run (g_seq_0, bus);
+}
+
+int test_01 (void)
+{
+  // replay on a memory-backed block.  the status poll times out first.
+  pll_regs r = { };
+  hw_init_mmio_bus bus (r, [] (uint32_t) { });
+
+  if (hw_init_seq_run (g_seq_1, bus) != 3)
+    return 1;
+
+  *(&r.status) = 1;
+  if (hw_init_seq_run (g_seq_1, bus) != hw_init_seq_size (g_seq_1))
+    return 2;
+
+  return r.div[0] == 1 && r.div[1] == 2 && r.ctrl == 1 ? 0 : 3;
+}
+
+int test_02 (void)
+{
+  // record a sequence on a simulated block, print and replay it.
+  pll_regs sim = { };
+  *(&sim.status) = 1;
+  hw_init_mmio_bus sim_bus (sim, [] (uint32_t) { });
+  hw_init_seq_recorder<hw_init_mmio_bus> rec (sim_bus);
+
+  rec.write (offsetof (pll_regs, div[2]), 0x55);
+  rec.modify (offsetof (pll_regs, ctrl), 0xF0, 0x30);
+  rec.poll (offsetof (pll_regs, status), 0x1, 0x1, 5);
+  rec.delay (100);
+
+  if (rec.ops ().size () != 4 || sim.div[2] != 0x55 || sim.ctrl != 0x30)
+    return 1;
+
+  std::ostringstream out;
+  rec.print (out, "seq");
+  if (out.str ().find ("hw_init_modify (0x0, 0x000000f0, 0x00000030)") == std::string::npos)
+    return 2;
+
+  // the stream formatting is restored.
+  out << std::setw (3) << 7;
+  if (out.fill () != ' ' || out.str ().compare (out.str ().size () - 3, 3, "  7") != 0)
+    return 5;
+
+  pll_regs dev = { };
+  *(&dev.status) = 1;
+  hw_init_mmio_bus dev_bus (dev, [] (uint32_t) { });
+  if (rec.replay (dev_bus) != 4)
+    return 3;
+
+  return dev.div[2] == 0x55 && dev.ctrl == 0x30 ? 0 : 4;
+}
+
+int main (void)
+{
+  if (int r = test_01 ())
+    return r;
+  if (int r = test_02 ())
+    return 10 + r;
+  return 0;
+}
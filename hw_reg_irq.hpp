@@ -0,0 +1,180 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register interrupt status C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The interrupt status template class implements the usual interrupt handler
+sequence for status registers with write-one-to-clear (W1C) bits:
+
+  1. read the status register once.
+  2. acknowledge all set bits with a single write of the read value.
+  3. call the handler of each set bit.
+
+The handlers are given as a compile-time table of functions, one per status
+bit starting at bit 0.  The set bits are visited in ascending order with a
+count-trailing-zeros loop over the status snapshot, thus the dispatch costs
+no further register accesses and no virtual calls:
+
+  struct nic { ... };
+  void on_rx (nic& n);
+  void on_tx (nic& n);
+  void on_link (nic& n);
+
+  typedef hw_irq_status<decltype (nic_regs::irq_status), nic,
+			on_rx, on_tx, nullptr, on_link> nic_irq;	// bit 2 unused
+
+  void nic_isr (nic& n)
+  {
+    nic_irq::handle (n.regs.irq_status, n);	// 1 read, 1 write
+  }
+
+Bits without a handler (nullptr entries and bits beyond the table) are
+acknowledged as well, but not dispatched.  If the device has a separate
+acknowledge register, it can be passed to handle as the second register.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_IRQ_HEADER_INCLUDED__
+#define __HWREG_IRQ_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+// mask with the bits of all non-null handlers.
+template <typename Ctx> constexpr uint64_t hw_irq_handler_mask (unsigned) noexcept
+{
+  return 0;
+}
+
+template <typename Ctx, typename... Rest>
+constexpr uint64_t hw_irq_handler_mask (unsigned bit, void (*h) (Ctx&), Rest... rest) noexcept
+{
+  return (h != nullptr ? uint64_t (1) << bit : 0) | hw_irq_handler_mask<Ctx> (bit + 1, rest...);
+}
+
+template <typename Reg, typename Ctx, void (*... Handlers) (Ctx&)> class hw_irq_status
+{
+public:
+  typedef typename Reg::base_type mask_type;
+  typedef void (*handler_type) (Ctx&);
+
+  static constexpr unsigned handler_count = sizeof... (Handlers);
+
+  static_assert (std::is_integral<mask_type>::value && std::is_unsigned<mask_type>::value
+		 , "hw_irq_status register must be of unsigned integral type");
+  static_assert (handler_count > 0 && handler_count <= sizeof (mask_type) * 8
+		 , "hw_irq_status needs one handler per status bit");
+
+  // bits that have a handler.
+  static constexpr mask_type handled_mask = static_cast<mask_type> (hw_irq_handler_mask<Ctx> (0, Handlers...));
+
+  // read the status register and acknowledge all set bits with one write.
+  // returns the snapshot.
+  static mask_type snapshot_ack (Reg& status)
+  {
+    return snapshot_ack (status, status);
+  }
+
+  template <typename AckReg> static mask_type snapshot_ack (const Reg& status, AckReg& ack)
+  {
+    const mask_type bits = status.read ();
+    if (bits != 0)
+      ack = bits;
+    return bits;
+  }
+
+  // call the handlers of the bits that are set in a status snapshot.
+  static void dispatch (mask_type bits, Ctx& ctx)
+  {
+    for (uint64_t b = bits & handled_mask; b != 0; b &= b - 1)
+      table[__builtin_ctzll (b)] (ctx);
+  }
+
+  // snapshot, acknowledge and dispatch.  returns the snapshot.
+  static mask_type handle (Reg& status, Ctx& ctx)
+  {
+    const mask_type bits = snapshot_ack (status);
+    dispatch (bits, ctx);
+    return bits;
+  }
+
+  template <typename AckReg> static mask_type handle (const Reg& status, AckReg& ack, Ctx& ctx)
+  {
+    const mask_type bits = snapshot_ack (status, ack);
+    dispatch (bits, ctx);
+    return bits;
+  }
+
+private:
+  static constexpr handler_type table[handler_count] = { Handlers... };
+};
+
+template <typename Reg, typename Ctx, void (*... Handlers) (Ctx&)>
+constexpr typename hw_irq_status<Reg, Ctx, Handlers...>::handler_type
+hw_irq_status<Reg, Ctx, Handlers...>::table[hw_irq_status<Reg, Ctx, Handlers...>::handler_count];
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_IRQ_HEADER_INCLUDED__
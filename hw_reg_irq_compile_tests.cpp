@@ -0,0 +1,118 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register interrupt status tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_irq_compile_tests.cpp
+
+The status registers are ordinary memory register blocks.  The resulting
+executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_irq.hpp"
+
+using namespace test_namespace;
+
+struct nic_regs
+{
+  hw_reg_rw	<uint32_t> irq_status;	// write-one-to-clear
+  hw_reg_r	<uint32_t> irq_raw;
+  hw_reg_w	<uint32_t> irq_ack;	// write-one-to-clear for irq_raw
+};
+
+struct nic
+{
+  nic_regs* regs;
+  unsigned rx, tx, link;
+  unsigned order[8];
+  unsigned order_count;
+};
+
+static void on_rx (nic& n) { ++n.rx; n.order[n.order_count++] = 0; }
+static void on_tx (nic& n) { ++n.tx; n.order[n.order_count++] = 1; }
+static void on_link (nic& n) { ++n.link; n.order[n.order_count++] = 3; }
+
+typedef hw_irq_status<decltype (nic_regs::irq_status), nic, on_rx, on_tx, nullptr, on_link> nic_irq;
+typedef hw_irq_status<decltype (nic_regs::irq_raw), nic, on_rx, on_tx> nic_raw_irq;
+
+static_assert (nic_irq::handled_mask == 0xB, "unexpected handler mask");
+
+uint32_t test_00 (nic& n)
+{
+  return nic_irq::handle (n.regs->irq_status, n);	// 1 read, 1 write, ctz dispatch
+}
+
+uint32_t test_01 (nic& n)
+{
+  return nic_raw_irq::handle (n.regs->irq_raw, n.regs->irq_ack, n);	// separate acknowledge register
+//return nic_raw_irq::handle (n.regs->irq_raw, n);			// NG: compile time error, read-only
+}
+
+static bool check_dispatch (void)
+{
+  nic_regs r;
+  nic n = { &r, 0, 0, 0, { }, 0 };
+
+  *(&r.irq_status) = 0x8000000F;
+  if (nic_irq::handle (r.irq_status, n) != 0x8000000F)
+    return false;
+
+  // all bits acknowledged, handlers called in bit order, bits 2 and 31 skipped
+  if (*(&r.irq_status) != 0x8000000F || n.rx != 1 || n.tx != 1 || n.link != 1)
+    return false;
+  if (n.order_count != 3 || n.order[0] != 0 || n.order[1] != 1 || n.order[2] != 3)
+    return false;
+
+  // nothing pending: no acknowledge write
+  *(&r.irq_status) = 0;
+  *(&r.irq_ack) = 0x55;
+  *(&r.irq_raw) = 0;
+  if (nic_raw_irq::handle (r.irq_raw, r.irq_ack, n) != 0 || *(&r.irq_ack) != 0x55)
+    return false;
+
+  *(&r.irq_raw) = 0x2;
+  return nic_raw_irq::handle (r.irq_raw, r.irq_ack, n) == 0x2 && *(&r.irq_ack) == 0x2 && n.tx == 2;
+}
+
+int main (void)
+{
+  if (!check_dispatch ())
+    return 1;
+  return 0;
+}
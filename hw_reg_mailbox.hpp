@@ -0,0 +1,326 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register command mailbox C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+The optional coroutine interface requires C++20, see below.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The mailbox template class implements the CPU side of a command mailbox with
+multiple slots, as found in many firmware management interfaces:
+
+  - each slot is a register block that holds a command and, after
+    completion, its response.  the slots are a hw_reg_array.
+  - the doorbell register has one bit per slot.  writing a 1 to a bit hands
+    the slot over to the device.
+  - the done register has one bit per slot, which the device sets when it
+    has completed the command.  the bits are acknowledged by writing 1s to
+    the acknowledge register, which is usually the done register itself
+    (write-one-to-clear).
+
+Commands are placed into free slots with post, which does not notify the
+device.  flush writes the doorbell bits of all posted commands with a
+single register write, so that several commands can be pipelined and the
+device is notified only once.  poll reads the done register once,
+acknowledges all completed slots with a single write and calls a completion
+function for each of them.  The slot contents are ordered against the
+doorbell write and the done register read with the DMA barriers of
+hw_reg.hpp:
+
+  struct mbox_slot
+  {
+    hw_reg_rw<uint32_t> opcode;
+    hw_reg_rw<uint32_t> arg[6];
+    hw_reg_rw<uint32_t> status;
+  };
+
+  struct mbox_regs
+  {
+    hw_reg_array<mbox_slot, 8, 0x20> slot;
+    hw_reg_w<uint32_t> doorbell;
+    hw_reg_rw<uint32_t> done;		// write-one-to-clear
+  };
+
+  hw_mailbox<decltype (mbox_regs::slot), hw_reg_w<uint32_t>, hw_reg_rw<uint32_t>>
+    mb (regs.slot, regs.doorbell, regs.done, regs.done);
+
+  mb.post ([&] (mbox_slot& s) { s.opcode = OP_READ_TEMP; });
+  mb.post ([&] (mbox_slot& s) { s.opcode = OP_READ_VOLT; });
+  mb.flush ();					// one doorbell write
+
+  mb.poll ([] (unsigned slot, mbox_slot& s, hw_mailbox_clock::duration latency)
+  {
+    handle_response (s.status);
+  });
+
+The latency of each command, from the doorbell write until the completion
+has been seen by poll, is passed to the completion function and accumulated
+in the mailbox statistics.
+
+If the compiler supports coroutines (C++20), hw_reg_async.hpp is included
+and the completion of a slot can also be awaited in a hw_reg_task coroutine:
+
+  int slot = mb.post (...);
+  mb.flush ();
+  co_await mb.completion (slot);
+  mb.poll (...);
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_MAILBOX_HEADER_INCLUDED__
+#define __HWREG_MAILBOX_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <chrono>
+#include <memory>
+
+#include "hw_reg.hpp"
+
+#if defined (__cpp_impl_coroutine)
+#include "hw_reg_async.hpp"
+#endif
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+typedef std::chrono::steady_clock hw_mailbox_clock;
+
+struct hw_mailbox_stats
+{
+  uint64_t posted;
+  uint64_t completed;
+  uint64_t doorbells;		// doorbell register writes
+  hw_mailbox_clock::duration total_latency;
+  hw_mailbox_clock::duration min_latency;
+  hw_mailbox_clock::duration max_latency;
+
+  hw_mailbox_clock::duration mean_latency (void) const noexcept
+  {
+    return completed != 0 ? total_latency / static_cast<hw_mailbox_clock::rep> (completed)
+			   : hw_mailbox_clock::duration::zero ();
+  }
+};
+
+template <typename SlotArray, typename DoorbellReg, typename DoneReg, typename AckReg = DoneReg>
+class hw_mailbox
+{
+public:
+  typedef typename SlotArray::value_type slot_type;
+  typedef typename DoneReg::base_type mask_type;
+
+  static constexpr unsigned size = SlotArray::size;
+
+  static_assert (std::is_integral<mask_type>::value && std::is_unsigned<mask_type>::value
+		 , "hw_mailbox done register must be of unsigned integral type");
+  static_assert (size > 0 && size <= sizeof (mask_type) * 8 && size <= 64
+		 , "hw_mailbox has more slots than done register bits");
+
+  hw_mailbox (SlotArray& slots, DoorbellReg& doorbell, const DoneReg& done, AckReg& ack) noexcept
+    : __slots (std::addressof (slots)), __doorbell (std::addressof (doorbell)),
+      __done (std::addressof (done)), __ack (std::addressof (ack)),
+      __busy (0), __posted (0), __in_flight (0)
+  {
+    reset_stats ();
+  }
+
+  hw_mailbox (const hw_mailbox&) = delete;
+  hw_mailbox& operator = (const hw_mailbox&) = delete;
+
+  // number of free slots.
+  unsigned free_count (void) const noexcept { return size - __builtin_popcountll (__busy); }
+
+  // number of commands that have been posted but not flushed.
+  unsigned posted_count (void) const noexcept { return __builtin_popcountll (__posted); }
+
+  // number of commands that have been flushed but not completed.
+  unsigned in_flight_count (void) const noexcept { return __builtin_popcountll (__in_flight); }
+
+  bool idle (void) const noexcept { return __busy == 0; }
+
+  // call fill (slot_type&) to place a command into a free slot, without
+  // notifying the device.  returns the slot index, or -1 if all slots are busy.
+  template <typename F> int post (F&& fill)
+  {
+    const uint64_t free_slots = ~__busy & all_slots;
+    if (free_slots == 0)
+      return -1;
+
+    const unsigned i = __builtin_ctzll (free_slots);
+    fill ((*__slots)[i]);
+
+    __busy |= uint64_t (1) << i;
+    __posted |= uint64_t (1) << i;
+    ++__stats.posted;
+    return static_cast<int> (i);
+  }
+
+  // hand all posted commands over to the device with a single doorbell write.
+  // returns the number of commands.
+  unsigned flush (void)
+  {
+    if (__posted == 0)
+      return 0;
+
+    const hw_mailbox_clock::time_point now = hw_mailbox_clock::now ();
+    for (uint64_t bits = __posted; bits != 0; bits &= bits - 1)
+      __start[__builtin_ctzll (bits)] = now;
+
+    __HW_REG_DMA_WMB__ ();
+    *__doorbell = static_cast<typename DoorbellReg::base_type> (__posted);
+
+    const unsigned n = __builtin_popcountll (__posted);
+    __in_flight |= __posted;
+    __posted = 0;
+    ++__stats.doorbells;
+    return n;
+  }
+
+  // post a single command and flush it immediately.
+  template <typename F> int post_flush (F&& fill)
+  {
+    const int i = post (fill);
+    if (i >= 0)
+      flush ();
+    return i;
+  }
+
+  // read the done register once, acknowledge all completed commands with a
+  // single write and call f (unsigned slot, slot_type&, duration latency) for
+  // each of them in slot order.  the slots are free again after f returns.
+  // returns the number of completed commands.
+  template <typename F> unsigned poll (F&& f)
+  {
+    if (__in_flight == 0)
+      return 0;
+
+    const uint64_t done = static_cast<uint64_t> (__done->read ()) & __in_flight;
+    __HW_REG_DMA_RMB__ ();
+    if (done == 0)
+      return 0;
+
+    *__ack = static_cast<typename AckReg::base_type> (done);
+
+    const hw_mailbox_clock::time_point now = hw_mailbox_clock::now ();
+    __in_flight &= ~done;
+
+    unsigned n = 0;
+    for (uint64_t bits = done; bits != 0; bits &= bits - 1, ++n)
+    {
+      const unsigned i = __builtin_ctzll (bits);
+      const hw_mailbox_clock::duration lat = now - __start[i];
+      record_latency (lat);
+      f (i, (*__slots)[i], lat);
+      __busy &= ~(uint64_t (1) << i);
+    }
+    return n;
+  }
+
+  // complete commands without looking at their responses.
+  unsigned poll (void)
+  {
+    return poll ([] (unsigned, slot_type&, hw_mailbox_clock::duration) { });
+  }
+
+  const hw_mailbox_stats& stats (void) const noexcept { return __stats; }
+
+  void reset_stats (void) noexcept
+  {
+    __stats = hw_mailbox_stats ();
+    __stats.total_latency = hw_mailbox_clock::duration::zero ();
+    __stats.min_latency = hw_mailbox_clock::duration::max ();
+    __stats.max_latency = hw_mailbox_clock::duration::zero ();
+  }
+
+#if defined (__cpp_impl_coroutine)
+  // awaitable that resumes a hw_reg_task when the done bit of a slot is set.
+  hw_reg_condition<DoneReg> completion (unsigned slot) const noexcept
+  {
+    const mask_type bit = mask_type (1) << slot;
+    return reg_condition (*__done, bit, bit);
+  }
+#endif
+
+private:
+  static constexpr uint64_t all_slots = size == 64 ? ~uint64_t (0) : (uint64_t (1) << size) - 1;
+
+  void record_latency (hw_mailbox_clock::duration lat) noexcept
+  {
+    ++__stats.completed;
+    __stats.total_latency += lat;
+    if (lat < __stats.min_latency)
+      __stats.min_latency = lat;
+    if (lat > __stats.max_latency)
+      __stats.max_latency = lat;
+  }
+
+  SlotArray* const __slots;
+  DoorbellReg* const __doorbell;
+  const DoneReg* const __done;
+  AckReg* const __ack;
+
+  uint64_t __busy;		// posted, in flight or being completed
+  uint64_t __posted;		// posted, doorbell not written yet
+  uint64_t __in_flight;		// doorbell written, not completed yet
+  hw_mailbox_clock::time_point __start[size];
+  hw_mailbox_stats __stats;
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_MAILBOX_HEADER_INCLUDED__
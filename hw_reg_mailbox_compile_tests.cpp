@@ -0,0 +1,235 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register command mailbox tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_mailbox_compile_tests.cpp
+  g++ -std=c++20 -O2 hw_reg_mailbox_compile_tests.cpp	(with coroutine tests)
+
+The device is simulated by a function that is called between the driver
+steps and operates on an ordinary memory register block.  The resulting
+executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_mailbox.hpp"
+
+using namespace test_namespace;
+
+struct mbox_slot
+{
+  hw_reg_rw	<uint32_t> opcode;
+  hw_reg_rw	<uint32_t> arg;
+  hw_reg_rw	<uint32_t> result;
+};
+
+struct mbox_regs
+{
+  hw_reg_array	<mbox_slot, 8, 0x10> slot;
+  hw_reg_w	<uint32_t> doorbell;
+  hw_reg_rw	<uint32_t> done;		// set by the device
+  hw_reg_w	<uint32_t> done_ack;	// write-one-to-clear for done
+};
+
+typedef hw_mailbox<decltype (mbox_regs::slot), hw_reg_w<uint32_t>,
+		   hw_reg_rw<uint32_t>, hw_reg_w<uint32_t>> mailbox_type;
+
+int test_00 (mailbox_type& mb, uint32_t op)
+{
+  return mb.post ([=] (mbox_slot& s) { s.opcode = op; });	// no doorbell write
+}
+
+unsigned test_01 (mailbox_type& mb)
+{
+  return mb.flush ();		// one doorbell write for all posted commands
+}
+
+unsigned test_02 (mailbox_type& mb, uint32_t* results)
+{
+  // one done read, one acknowledge write
+  return mb.poll ([=] (unsigned i, mbox_slot& s, hw_mailbox_clock::duration)
+  {
+    results[i] = s.result;
+  });
+}
+
+// processes acknowledges and doorbells.  opcode 1 adds 1 to arg, opcode 2
+// doubles it.  only commands with an odd arg are completed immediately if
+// complete_odd_only is set.
+static unsigned device_doorbells;
+static uint32_t device_pending;
+
+static void device_step (mbox_regs& r, bool complete_odd_only = false)
+{
+  uint32_t done = *(&r.done) & ~*(&r.done_ack);
+  *(&r.done_ack) = 0;
+
+  const uint32_t db = *(&r.doorbell);
+  if (db != 0)
+    ++device_doorbells;
+  *(&r.doorbell) = 0;
+
+  device_pending |= db;
+  for (uint32_t bits = device_pending; bits != 0; bits &= bits - 1)
+  {
+    const unsigned i = __builtin_ctz (bits);
+    mbox_slot& s = r.slot[i];
+    if (complete_odd_only && (*(&s.arg) & 1) == 0)
+      continue;
+
+    *(&s.result) = s.opcode == 1 ? s.arg + 1 : s.arg * 2;
+    done |= 1u << i;
+    device_pending &= ~(1u << i);
+  }
+  *(&r.done) = done;
+}
+
+static void clear_regs (mbox_regs& r)
+{
+  *(&r.doorbell) = 0;
+  *(&r.done) = 0;
+  *(&r.done_ack) = 0;
+  device_doorbells = 0;
+  device_pending = 0;
+}
+
+static bool check_batch (void)
+{
+  mbox_regs r;
+  clear_regs (r);
+  mailbox_type mb (r.slot, r.doorbell, r.done, r.done_ack);
+
+  for (uint32_t i = 0; i < 8; ++i)
+    if (mb.post ([=] (mbox_slot& s) { s.opcode = 1 + (i & 1); s.arg = i + 10; }) != int (i))
+      return false;
+
+  if (mb.post ([] (mbox_slot&) { }) != -1 || mb.free_count () != 0)
+    return false;
+  if (mb.flush () != 8 || mb.flush () != 0)
+    return false;
+
+  device_step (r, true);
+
+  uint32_t results[8] = { };
+  if (mb.poll ([&] (unsigned i, mbox_slot& s, hw_mailbox_clock::duration) { results[i] = s.result; }) != 4)
+    return false;
+  if (mb.in_flight_count () != 4 || mb.free_count () != 4)
+    return false;
+
+  device_step (r);
+  if (mb.poll ([&] (unsigned i, mbox_slot& s, hw_mailbox_clock::duration) { results[i] = s.result; }) != 4)
+    return false;
+
+  for (uint32_t i = 0; i < 8; ++i)
+    if (results[i] != ((i & 1) ? (i + 10) * 2 : i + 11))
+      return false;
+
+  return mb.idle () && device_doorbells == 1
+	 && mb.stats ().completed == 8 && mb.stats ().doorbells == 1
+	 && mb.stats ().min_latency <= mb.stats ().max_latency;
+}
+
+static bool check_pipeline (void)
+{
+  mbox_regs r;
+  clear_regs (r);
+  mailbox_type mb (r.slot, r.doorbell, r.done, r.done_ack);
+
+  // keep the mailbox full, refill completed slots in batches.
+  unsigned sent = 0, received = 0;
+  uint32_t sum = 0;
+  while (received < 100)
+  {
+    while (sent < 100 && mb.post ([=] (mbox_slot& s) { s.opcode = 1; s.arg = sent; }) >= 0)
+      ++sent;
+    mb.flush ();
+    device_step (r);
+    received += mb.poll ([&] (unsigned, mbox_slot& s, hw_mailbox_clock::duration) { sum += s.result; });
+  }
+
+  return sum == 100 * 99 / 2 + 100 && device_doorbells == mb.stats ().doorbells
+	 && mb.stats ().doorbells < 100;
+}
+
+#if defined (__cpp_impl_coroutine)
+
+static hw_reg_task command_task (mailbox_type& mb, uint32_t arg, uint32_t& result)
+{
+  const int slot = mb.post_flush ([=] (mbox_slot& s) { s.opcode = 2; s.arg = arg; });
+  co_await mb.completion (slot);
+  mb.poll ([&] (unsigned, mbox_slot& s, hw_mailbox_clock::duration) { result = s.result; });
+}
+
+static hw_reg_task device_task (mbox_regs& r)
+{
+  co_await reg_condition (r.slot[0].opcode, 0xFF, 2);	// wait for the command
+  device_step (r);
+}
+
+static bool check_await (void)
+{
+  mbox_regs r;
+  clear_regs (r);
+  mailbox_type mb (r.slot, r.doorbell, r.done, r.done_ack);
+  r.slot[0].opcode = 0;
+
+  uint32_t result = 0;
+  hw_reg_poll_scheduler sched;
+  sched.spawn (command_task (mb, 21, result));
+  sched.spawn (device_task (r));
+  sched.run ();
+
+  return result == 42 && mb.idle ();
+}
+
+#else
+
+static bool check_await (void) { return true; }
+
+#endif
+
+int main (void)
+{
+  if (!check_batch ())
+    return 1;
+  if (!check_pipeline ())
+    return 2;
+  if (!check_await ())
+    return 3;
+  return 0;
+}
@@ -0,0 +1,471 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register map description C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++20 language and library features (class type
+non-type template parameters) and thus requires a compiler and an STL
+implementation that supports C++20.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The register map template class turns a textual register description into a
+typed register layout at compile time.  Register maps are usually taken from
+vendor documentation, and transcribing them by hand into structs with
+padding arrays is error-prone.  A description can be copied almost verbatim
+instead:
+
+  static constexpr hw_reg_map_string uart_desc =
+    "reg   data     0x00  rw  32    \n"
+    "reg   ctrl     0x04  rw  32    \n"
+    "field enable   0     1         \n"
+    "field mode     4     3         \n"
+    "reg   status   0x08  r   32    \n"
+    "field rx_ready 0               \n"
+    "reg   baud     0x10  w   16    \n";
+
+  typedef hw_reg_map<uart_desc> uart_map;
+
+Each line is one of
+
+  reg <name> <offset> <access> [<width>]
+  field <name> <position> [<width>]
+
+where access is r, w or rw, the register width is 8, 16, 32 (default) or 64
+bits and the field width defaults to 1 bit.  Field lines belong to the
+preceding register.  Empty lines and lines starting with # are ignored.
+Numbers are decimal or hexadecimal with a 0x prefix.
+
+The description is checked at compile time.  Syntax errors, misaligned
+registers, overlapping registers or fields, fields exceeding their register
+and duplicate names result in a compile time error that mentions a function
+named hw_reg_map_error_<problem>.
+
+The registers are normal hw_reg types and are accessed through the block
+type of the map, which is placed at the register base address:
+
+  uart_map::block& regs = *reinterpret_cast<uart_map::block*> (base);
+
+  regs.reg<"data"> () = c;
+  uart_map::field<"ctrl", "mode">::set (regs.reg<"ctrl"> (), 2);
+  while (!uart_map::field<"status", "rx_ready">::get (regs.reg<"status"> ()));
+
+If the base address is a constant, constant address registers can be used:
+
+  static constexpr uart_map::const_reg<"status", 0xA0001000> UART_STATUS;
+  typedef uart_map::const_field<"status", "rx_ready", 0xA0001000> UART_RX_READY;
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_MAP_HEADER_INCLUDED__
+#define __HWREG_MAP_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string_view>
+#include <type_traits>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+// string that can be used as a template argument.
+template <std::size_t N> struct hw_reg_map_string
+{
+  char data[N] = { };
+
+  constexpr hw_reg_map_string (const char (&s)[N]) noexcept
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      data[i] = s[i];
+  }
+
+  constexpr std::string_view view (void) const noexcept { return std::string_view (data, N - 1); }
+};
+
+// the following functions are not constexpr.  a description error makes the
+// parser call one of them during constant evaluation, which the compiler
+// reports as an error mentioning the function name.
+inline void hw_reg_map_error_syntax (void) { }
+inline void hw_reg_map_error_bad_number (void) { }
+inline void hw_reg_map_error_bad_access (void) { }
+inline void hw_reg_map_error_bad_width (void) { }
+inline void hw_reg_map_error_field_without_register (void) { }
+inline void hw_reg_map_error_misaligned_register (void) { }
+inline void hw_reg_map_error_overlapping_registers (void) { }
+inline void hw_reg_map_error_duplicate_register_name (void) { }
+inline void hw_reg_map_error_field_exceeds_register (void) { }
+inline void hw_reg_map_error_overlapping_fields (void) { }
+inline void hw_reg_map_error_duplicate_field_name (void) { }
+inline void hw_reg_map_error_unknown_register (void) { }
+inline void hw_reg_map_error_unknown_field (void) { }
+
+struct hw_reg_map_reg_desc
+{
+  std::string_view name;
+  std::size_t offset;
+  unsigned width;
+  bool readable;
+  bool writable;
+  std::size_t first_field;
+  std::size_t field_count;
+};
+
+struct hw_reg_map_field_desc
+{
+  std::string_view name;
+  unsigned position;
+  unsigned width;
+};
+
+// line and token scanner for register descriptions.
+class hw_reg_map_scanner
+{
+public:
+  constexpr explicit hw_reg_map_scanner (std::string_view s) noexcept
+    : __s (s), __pos (0), __line_end (0), __next (0)
+  { }
+
+  // advance to the next non-empty line.  returns false at the end.
+  constexpr bool next_line (void) noexcept
+  {
+    while (__next <= __s.size ())
+    {
+      __pos = __next;
+      __line_end = __s.find ('\n', __pos);
+      if (__line_end == std::string_view::npos)
+	__line_end = __s.size ();
+      __next = __line_end + 1;
+
+      skip_space ();
+      if (__pos < __line_end && __s[__pos] != '#')
+	return true;
+    }
+    return false;
+  }
+
+  // next token in the current line, empty at the end of the line.
+  constexpr std::string_view token (void) noexcept
+  {
+    skip_space ();
+    const std::size_t begin = __pos;
+    while (__pos < __line_end && !is_space (__s[__pos]))
+      ++__pos;
+    return __s.substr (begin, __pos - begin);
+  }
+
+  constexpr bool at_line_end (void) noexcept
+  {
+    skip_space ();
+    return __pos >= __line_end;
+  }
+
+private:
+  static constexpr bool is_space (char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+  constexpr void skip_space (void) noexcept
+  {
+    while (__pos < __line_end && is_space (__s[__pos]))
+      ++__pos;
+  }
+
+  std::string_view __s;
+  std::size_t __pos;
+  std::size_t __line_end;
+  std::size_t __next;
+};
+
+constexpr std::size_t hw_reg_map_number (std::string_view t) noexcept
+{
+  std::size_t base = 10;
+  if (t.size () > 2 && t[0] == '0' && (t[1] == 'x' || t[1] == 'X'))
+  {
+    base = 16;
+    t.remove_prefix (2);
+  }
+  if (t.empty ())
+    hw_reg_map_error_bad_number ();
+
+  std::size_t v = 0;
+  for (char c : t)
+  {
+    std::size_t d = 16;
+    if (c >= '0' && c <= '9')
+      d = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      d = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      d = c - 'A' + 10;
+    if (d >= base)
+      hw_reg_map_error_bad_number ();
+    v = v * base + d;
+  }
+  return v;
+}
+
+struct hw_reg_map_counts
+{
+  std::size_t regs;
+  std::size_t fields;
+};
+
+constexpr hw_reg_map_counts hw_reg_map_count (std::string_view s) noexcept
+{
+  hw_reg_map_counts c = { 0, 0 };
+  hw_reg_map_scanner sc (s);
+  while (sc.next_line ())
+  {
+    const std::string_view kw = sc.token ();
+    if (kw == "reg")
+      ++c.regs;
+    else if (kw == "field")
+      ++c.fields;
+    else
+      hw_reg_map_error_syntax ();
+  }
+  return c;
+}
+
+template <std::size_t R, std::size_t F> struct hw_reg_map_layout
+{
+  std::array<hw_reg_map_reg_desc, R> regs;
+  std::array<hw_reg_map_field_desc, F> fields;
+  std::size_t size;		// bytes up to the end of the last register
+  std::size_t align;		// widest register in bytes
+};
+
+template <std::size_t R, std::size_t F>
+constexpr hw_reg_map_layout<R, F> hw_reg_map_parse (std::string_view s) noexcept
+{
+  hw_reg_map_layout<R, F> m = { };
+  std::size_t ri = 0, fi = 0;
+  m.align = 1;
+
+  hw_reg_map_scanner sc (s);
+  while (sc.next_line ())
+  {
+    const std::string_view kw = sc.token ();
+    if (kw == "reg")
+    {
+      hw_reg_map_reg_desc& r = m.regs[ri++];
+      r.name = sc.token ();
+      r.offset = hw_reg_map_number (sc.token ());
+
+      const std::string_view access = sc.token ();
+      if (access == "r" || access == "rw")
+	r.readable = true;
+      if (access == "w" || access == "rw")
+	r.writable = true;
+      if (!r.readable && !r.writable)
+	hw_reg_map_error_bad_access ();
+
+      r.width = sc.at_line_end () ? 32 : static_cast<unsigned> (hw_reg_map_number (sc.token ()));
+      if (r.width != 8 && r.width != 16 && r.width != 32 && r.width != 64)
+	hw_reg_map_error_bad_width ();
+
+      r.first_field = fi;
+      r.field_count = 0;
+
+      if (r.offset % (r.width / 8) != 0)
+	hw_reg_map_error_misaligned_register ();
+      if (r.offset + r.width / 8 > m.size)
+	m.size = r.offset + r.width / 8;
+      if (r.width / 8 > m.align)
+	m.align = r.width / 8;
+    }
+    else
+    {
+      if (ri == 0)
+	hw_reg_map_error_field_without_register ();
+
+      hw_reg_map_field_desc& f = m.fields[fi++];
+      f.name = sc.token ();
+      f.position = static_cast<unsigned> (hw_reg_map_number (sc.token ()));
+      f.width = sc.at_line_end () ? 1 : static_cast<unsigned> (hw_reg_map_number (sc.token ()));
+      if (f.width == 0)
+	hw_reg_map_error_bad_width ();
+
+      hw_reg_map_reg_desc& r = m.regs[ri - 1];
+      if (f.position + f.width > r.width)
+	hw_reg_map_error_field_exceeds_register ();
+      ++r.field_count;
+    }
+
+    if (!sc.at_line_end ())
+      hw_reg_map_error_syntax ();
+  }
+
+  // checks across registers and fields.
+  for (std::size_t i = 0; i < R; ++i)
+    for (std::size_t j = i + 1; j < R; ++j)
+    {
+      const hw_reg_map_reg_desc& a = m.regs[i];
+      const hw_reg_map_reg_desc& b = m.regs[j];
+      if (a.name == b.name)
+	hw_reg_map_error_duplicate_register_name ();
+      if (a.offset < b.offset + b.width / 8 && b.offset < a.offset + a.width / 8)
+	hw_reg_map_error_overlapping_registers ();
+    }
+
+  for (std::size_t i = 0; i < R; ++i)
+  {
+    const hw_reg_map_reg_desc& r = m.regs[i];
+    for (std::size_t a = r.first_field; a < r.first_field + r.field_count; ++a)
+      for (std::size_t b = a + 1; b < r.first_field + r.field_count; ++b)
+      {
+	const hw_reg_map_field_desc& fa = m.fields[a];
+	const hw_reg_map_field_desc& fb = m.fields[b];
+	if (fa.name == fb.name)
+	  hw_reg_map_error_duplicate_field_name ();
+	if (fa.position < fb.position + fb.width && fb.position < fa.position + fa.width)
+	  hw_reg_map_error_overlapping_fields ();
+      }
+  }
+
+  return m;
+}
+
+template <unsigned Width> struct hw_reg_map_uint;
+template <> struct hw_reg_map_uint<8> { typedef uint8_t type; };
+template <> struct hw_reg_map_uint<16> { typedef uint16_t type; };
+template <> struct hw_reg_map_uint<32> { typedef uint32_t type; };
+template <> struct hw_reg_map_uint<64> { typedef uint64_t type; };
+
+template <hw_reg_map_string Desc> class hw_reg_map
+{
+  static constexpr hw_reg_map_counts counts = hw_reg_map_count (Desc.view ());
+
+public:
+  static constexpr hw_reg_map_layout<counts.regs, counts.fields> layout
+    = hw_reg_map_parse<counts.regs, counts.fields> (Desc.view ());
+
+  static constexpr std::size_t reg_count = counts.regs;
+  static constexpr std::size_t field_count = counts.fields;
+
+  // size of the register block, i.e. up to the end of the last register.
+  static constexpr std::size_t size = layout.size;
+
+  static constexpr std::size_t reg_index (std::string_view name) noexcept
+  {
+    for (std::size_t i = 0; i < reg_count; ++i)
+      if (layout.regs[i].name == name)
+	return i;
+    hw_reg_map_error_unknown_register ();
+    return 0;
+  }
+
+  static constexpr std::size_t field_index (std::string_view reg_name, std::string_view name) noexcept
+  {
+    const hw_reg_map_reg_desc& r = layout.regs[reg_index (reg_name)];
+    for (std::size_t i = r.first_field; i < r.first_field + r.field_count; ++i)
+      if (layout.fields[i].name == name)
+	return i;
+    hw_reg_map_error_unknown_field ();
+    return 0;
+  }
+
+  template <hw_reg_map_string Name> static constexpr std::size_t offset = layout.regs[reg_index (Name.view ())].offset;
+
+private:
+  template <hw_reg_map_string Name> static constexpr const hw_reg_map_reg_desc& desc = layout.regs[reg_index (Name.view ())];
+
+  template <hw_reg_map_string Name, typename A> using reg_type_at =
+    hw_reg<typename hw_reg_map_uint<desc<Name>.width>::type, desc<Name>.readable, desc<Name>.writable, A>;
+
+  template <typename Reg, const hw_reg_map_field_desc* F> using field_of =
+    hw_reg_field<Reg, F->position, F->width>;
+
+public:
+  // register type for register block members.
+  template <hw_reg_map_string Name> using reg_type = reg_type_at<Name, void>;
+
+  // register type with constant address.
+  template <hw_reg_map_string Name, uintptr_t Base> using const_reg = reg_type_at<Name, const_addr<Base + offset<Name>>>;
+
+  // bit field type of a register block member.
+  template <hw_reg_map_string RegName, hw_reg_map_string Name> using field =
+    field_of<reg_type<RegName>, &layout.fields[field_index (RegName.view (), Name.view ())]>;
+
+  // bit field type of a constant address register.
+  template <hw_reg_map_string RegName, hw_reg_map_string Name, uintptr_t Base> using const_field =
+    field_of<const_reg<RegName, Base>, &layout.fields[field_index (RegName.view (), Name.view ())]>;
+
+  // register block, to be placed at the register base address.
+  class block
+  {
+  public:
+    block (void) noexcept = default;
+    block (const block&) = delete;
+    block& operator = (const block&) = delete;
+
+    template <hw_reg_map_string Name> reg_type<Name>& reg (void) noexcept
+    {
+      return *reinterpret_cast<reg_type<Name>*> (__storage + offset<Name>);
+    }
+
+    template <hw_reg_map_string Name> const reg_type<Name>& reg (void) const noexcept
+    {
+      return *reinterpret_cast<const reg_type<Name>*> (__storage + offset<Name>);
+    }
+
+  private:
+    alignas (layout.align) unsigned char __storage[size];
+  };
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_MAP_HEADER_INCLUDED__
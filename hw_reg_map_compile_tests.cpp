@@ -0,0 +1,147 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register map description tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++20 -O2 hw_reg_map_compile_tests.cpp
+
+The register block is placed in ordinary memory.  The resulting executable
+returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_map.hpp"
+
+using namespace test_namespace;
+
+static constexpr hw_reg_map_string uart_desc =
+  "# uart register map\n"
+  "reg   data     0x00  rw  32\n"
+  "reg   ctrl     0x04  rw\n"
+  "field enable   0\n"
+  "field mode     4     3\n"
+  "field trim     8     8\n"
+  "\n"
+  "reg   status   0x08  r   32\n"
+  "field rx_ready 0\n"
+  "field tx_empty 1\n"
+  "reg   baud     0x10  w   16\n"
+  "reg   id       0x18  r   64\n";
+
+typedef hw_reg_map<uart_desc> uart_map;
+
+static_assert (uart_map::reg_count == 5 && uart_map::field_count == 5, "unexpected register count");
+static_assert (uart_map::size == 0x20, "unexpected register block size");
+static_assert (uart_map::offset<"baud"> == 0x10, "unexpected register offset");
+static_assert (std::is_same<uart_map::reg_type<"status">, hw_reg_r<uint32_t>>::value, "unexpected register type");
+static_assert (std::is_same<uart_map::reg_type<"baud">, hw_reg_w<uint16_t>>::value, "unexpected register type");
+static_assert (std::is_same<uart_map::reg_type<"id">, hw_reg_r<uint64_t>>::value, "unexpected register type");
+static_assert (uart_map::field<"ctrl", "mode">::mask == 0x70, "unexpected field mask");
+static_assert (sizeof (uart_map::block) == 0x20 && alignof (uart_map::block) == 8, "unexpected block layout");
+
+// same layout written by hand
+struct uart_regs
+{
+  hw_reg_rw	<uint32_t> data;
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_r	<uint32_t> status;
+  uint32_t __pad0;
+  hw_reg_w	<uint16_t> baud;
+};
+
+void test_00 (uart_map::block& r)
+{
+  uart_map::field<"ctrl", "mode">::set (r.reg<"ctrl"> (), 5);	// same code as test_01
+}
+
+void test_01 (uart_regs& r)
+{
+  r.ctrl = (r.ctrl & ~0x70u) | (5 << 4);
+}
+
+void test_02 (uart_map::block& r, uint16_t div)
+{
+  r.reg<"baud"> () = div;
+//r.reg<"baud"> () |= 1;		// NG: compile time error, write-only
+//r.reg<"bauds"> () = div;		// NG: compile time error, hw_reg_map_error_unknown_register
+}
+
+static constexpr uart_map::const_reg<"status", 0xA0001000> g_uart_status;
+
+bool test_03 (void)
+{
+  return uart_map::const_field<"status", "rx_ready", 0xA0001000>::get (g_uart_status);	// load from 0xA0001008
+}
+
+// NG: compile time errors
+//static constexpr hw_reg_map_string bad_0 = "reg a 0x02 rw 32\n";			// hw_reg_map_error_misaligned_register
+//static constexpr hw_reg_map_string bad_1 = "reg a 0x00 rw 32\nreg b 0x02 rw 16\n";	// hw_reg_map_error_overlapping_registers
+//static constexpr hw_reg_map_string bad_2 = "reg a 0x00 rw 8\nfield f 4 8\n";		// hw_reg_map_error_field_exceeds_register
+//static constexpr hw_reg_map_string bad_3 = "reg a 0x00 rw\nfield f 0 4\nfield g 3\n";	// hw_reg_map_error_overlapping_fields
+//static constexpr hw_reg_map_string bad_4 = "reg a 0x00 rw\nreg a 0x04 rw\n";		// hw_reg_map_error_duplicate_register_name
+//static constexpr hw_reg_map_string bad_5 = "reg a 0x00 rx\n";				// hw_reg_map_error_bad_access
+//static constexpr hw_reg_map_string bad_6 = "field f 0\n";					// hw_reg_map_error_field_without_register
+//static constexpr hw_reg_map_string bad_7 = "reg a 0x00 rw 32 junk\n";			// hw_reg_map_error_syntax
+//static constexpr std::size_t bad_size = hw_reg_map<bad_0>::size;
+
+static bool check_block (void)
+{
+  alignas (8) unsigned char mem[uart_map::size] = { };
+  uart_map::block& r = *reinterpret_cast<uart_map::block*> (mem);
+
+  r.reg<"data"> () = 0x12345678;
+  r.reg<"ctrl"> () = 0xFFFFFFFF;
+  uart_map::field<"ctrl", "mode">::set (r.reg<"ctrl"> (), 2);
+  uart_map::field<"ctrl", "trim">::set (r.reg<"ctrl"> (), 0x5A);
+  r.reg<"baud"> () = 0xBEEF;
+
+  uint32_t w[4];
+  uint16_t baud;
+  __builtin_memcpy (w, mem, sizeof (w));
+  __builtin_memcpy (&baud, mem + 0x10, sizeof (baud));
+
+  return w[0] == 0x12345678 && w[1] == 0xFFFF5AAF && baud == 0xBEEF
+	 && uart_map::field<"ctrl", "mode">::get (r.reg<"ctrl"> ()) == 2;
+}
+
+int main (void)
+{
+  if (!check_block ())
+    return 1;
+  return 0;
+}
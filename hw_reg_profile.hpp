@@ -0,0 +1,401 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register access profiler
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The register access profiler measures the latency of every hw_reg read and
+write and records it per register address.  It is enabled by defining
+__HW_REG_ENABLE_PROFILING__ before including hw_reg.hpp.  Without the macro
+the register accesses are plain volatile accesses and nothing of this header
+is used.
+
+  #define __HW_REG_ENABLE_PROFILING__
+  #include "hw_reg.hpp"
+
+  ... run the driver ...
+
+  hw_reg_profile::dump_text (std::cout);
+  hw_reg_profile::dump_json (json_file);
+
+On x86 the latency is measured with serialized TSC reads (lfence; rdtsc
+before and rdtscp; lfence after the access) and reported in TSC ticks.
+On other targets a monotonic clock in nanoseconds is used.
+
+The latencies of each register and access direction are recorded in a
+log-linear histogram with 4 sub-buckets per power of two, i.e. with a
+relative bucket width of at most 25%.  The per-register slots are allocated
+from a fixed table of __HW_REG_PROFILE_SLOTS__ entries (default 1024).
+Accesses to registers that do not fit into the table are counted as
+dropped.  Recording is lock-free and can be done from multiple threads.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_PROFILE_HEADER_INCLUDED__
+#define __HWREG_PROFILE_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <ostream>
+
+#if defined (__i386__) || defined (__x86_64__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef __HW_REG_PROFILE_SLOTS__
+#define __HW_REG_PROFILE_SLOTS__ 1024
+#endif
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+enum hw_reg_profile_kind : unsigned
+{
+  HW_REG_PROFILE_READ = 0,
+  HW_REG_PROFILE_WRITE = 1
+};
+
+// timestamp before the measured access.  no earlier instruction can be
+// executed after the timestamp and the access cannot start before it.
+inline uint64_t hw_reg_profile_begin (void) noexcept
+{
+#if defined (__i386__) || defined (__x86_64__)
+  _mm_lfence ();
+  const uint64_t t = __rdtsc ();
+  _mm_lfence ();
+  return t;
+#else
+  timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return uint64_t (ts.tv_sec) * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+// timestamp after the measured access.  rdtscp waits for all earlier
+// instructions to complete.
+inline uint64_t hw_reg_profile_end (void) noexcept
+{
+#if defined (__i386__) || defined (__x86_64__)
+  unsigned aux;
+  const uint64_t t = __rdtscp (&aux);
+  _mm_lfence ();
+  return t;
+#else
+  return hw_reg_profile_begin ();
+#endif
+}
+
+// log-linear latency histogram.
+struct hw_reg_profile_histogram
+{
+  static constexpr unsigned bucket_count = 252;
+
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;		// stored as ~min, so that zero initialization works
+  uint64_t max;
+  uint64_t buckets[bucket_count];
+
+  static unsigned bucket_of (uint64_t v) noexcept
+  {
+    if (v < 4)
+      return static_cast<unsigned> (v);
+    const unsigned msb = 63 - __builtin_clzll (v);
+    return (msb - 1) * 4 + static_cast<unsigned> ((v >> (msb - 2)) & 3);
+  }
+
+  // smallest value of bucket i.
+  static uint64_t bucket_floor (unsigned i) noexcept
+  {
+    if (i < 4)
+      return i;
+    const unsigned msb = i / 4 + 1;
+    return uint64_t (4 + i % 4) << (msb - 2);
+  }
+
+  void record (uint64_t v) noexcept
+  {
+    __atomic_fetch_add (&count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&sum, v, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&buckets[bucket_of (v)], 1, __ATOMIC_RELAXED);
+
+    uint64_t m = __atomic_load_n (&max, __ATOMIC_RELAXED);
+    while (v > m && !__atomic_compare_exchange_n (&max, &m, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+    m = __atomic_load_n (&min, __ATOMIC_RELAXED);
+    while (~v > m && !__atomic_compare_exchange_n (&min, &m, ~v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+  }
+
+  uint64_t min_value (void) const noexcept { return count != 0 ? ~min : 0; }
+  uint64_t mean (void) const noexcept { return count != 0 ? sum / count : 0; }
+
+  // lower bound of the value below which the fraction q of the samples lie.
+  // the bucket bound is clamped to the recorded range, so that values that
+  // have never been seen are not reported.
+  uint64_t percentile (double q) const noexcept
+  {
+    const uint64_t rank = static_cast<uint64_t> (q * count);
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < bucket_count; ++i)
+    {
+      seen += buckets[i];
+      if (seen > rank)
+      {
+	const uint64_t v = bucket_floor (i);
+	return v < min_value () ? min_value () : v > max ? max : v;
+      }
+    }
+    return max;
+  }
+};
+
+struct hw_reg_profile_slot
+{
+  uintptr_t key;	// (address << 1) | kind + 1, 0 if unused
+  hw_reg_profile_histogram hist;
+
+  uintptr_t address (void) const noexcept { return (key - 1) >> 1; }
+  hw_reg_profile_kind kind (void) const noexcept { return hw_reg_profile_kind ((key - 1) & 1); }
+};
+
+// the profile data.  a class template is used to get zero initialized
+// static storage in a header without guard variables.
+template <typename Dummy = void> class hw_reg_profile_t
+{
+public:
+  static constexpr std::size_t slot_count = __HW_REG_PROFILE_SLOTS__;
+
+  static_assert ((slot_count & (slot_count - 1)) == 0, "__HW_REG_PROFILE_SLOTS__ must be a power of two");
+
+  static void record (const volatile void* addr, hw_reg_profile_kind kind, uint64_t ticks) noexcept
+  {
+    hw_reg_profile_slot* s = find (reinterpret_cast<uintptr_t> (addr), kind);
+    if (s != nullptr)
+      s->hist.record (ticks);
+    else
+      __atomic_fetch_add (&__dropped, 1, __ATOMIC_RELAXED);
+  }
+
+  // histogram of a register, or nullptr if it has not been accessed.
+  static const hw_reg_profile_histogram* histogram (const volatile void* addr, hw_reg_profile_kind kind) noexcept
+  {
+    const uintptr_t key = make_key (reinterpret_cast<uintptr_t> (addr), kind);
+    for (std::size_t i = 0, h = hash (key); i < slot_count; ++i, h = (h + 1) & (slot_count - 1))
+    {
+      const uintptr_t k = __atomic_load_n (&__slots[h].key, __ATOMIC_ACQUIRE);
+      if (k == key)
+	return &__slots[h].hist;
+      if (k == 0)
+	return nullptr;
+    }
+    return nullptr;
+  }
+
+  static uint64_t dropped (void) noexcept { return __atomic_load_n (&__dropped, __ATOMIC_RELAXED); }
+
+  // not safe while other threads are recording.
+  static void reset (void) noexcept
+  {
+    for (std::size_t i = 0; i < slot_count; ++i)
+      __slots[i] = hw_reg_profile_slot ();
+    __dropped = 0;
+  }
+
+  static void dump_text (std::ostream& out)
+  {
+    out << "address            op     count       min      mean       p50       p99       max\n";
+    for_each_slot ([&] (const hw_reg_profile_slot& s)
+    {
+      const hw_reg_profile_histogram& h = s.hist;
+      char line[160];
+      std::snprintf (line, sizeof (line), "0x%016llx %-5s %9llu %9llu %9llu %9llu %9llu %9llu\n",
+		     (unsigned long long)s.address (), s.kind () == HW_REG_PROFILE_READ ? "read" : "write",
+		     (unsigned long long)h.count, (unsigned long long)h.min_value (),
+		     (unsigned long long)h.mean (), (unsigned long long)h.percentile (0.5),
+		     (unsigned long long)h.percentile (0.99), (unsigned long long)h.max);
+      out << line;
+    });
+    if (dropped () != 0)
+      out << "dropped " << dropped () << '\n';
+  }
+
+  // one object per register and access direction with the non-empty
+  // histogram buckets as [lower bound, count] pairs.
+  static void dump_json (std::ostream& out)
+  {
+    bool first = true;
+    out << "{\"unit\":\"" << unit () << "\",\"dropped\":" << dropped () << ",\"registers\":[";
+    for_each_slot ([&] (const hw_reg_profile_slot& s)
+    {
+      const hw_reg_profile_histogram& h = s.hist;
+      char addr[32];
+      std::snprintf (addr, sizeof (addr), "0x%llx", (unsigned long long)s.address ());
+
+      out << (first ? "" : ",") << "\n{\"address\":\"" << addr << "\",\"op\":\""
+	  << (s.kind () == HW_REG_PROFILE_READ ? "read" : "write")
+	  << "\",\"count\":" << h.count << ",\"sum\":" << h.sum
+	  << ",\"min\":" << h.min_value () << ",\"max\":" << h.max << ",\"buckets\":[";
+
+      bool first_bucket = true;
+      for (unsigned i = 0; i < h.bucket_count; ++i)
+	if (h.buckets[i] != 0)
+	{
+	  out << (first_bucket ? "" : ",") << '[' << h.bucket_floor (i) << ',' << h.buckets[i] << ']';
+	  first_bucket = false;
+	}
+      out << "]}";
+      first = false;
+    });
+    out << "\n]}\n";
+  }
+
+  static const char* unit (void) noexcept
+  {
+#if defined (__i386__) || defined (__x86_64__)
+    return "tsc";
+#else
+    return "ns";
+#endif
+  }
+
+private:
+  static uintptr_t make_key (uintptr_t addr, hw_reg_profile_kind kind) noexcept
+  {
+    return ((addr << 1) | kind) + 1;
+  }
+
+  static std::size_t hash (uintptr_t key) noexcept
+  {
+    return static_cast<std::size_t> ((key * uintptr_t (0x9E3779B97F4A7C15ull)) >> (sizeof (uintptr_t) * 8 - 20))
+	   & (slot_count - 1);
+  }
+
+  // find or claim the slot of a register.
+  static hw_reg_profile_slot* find (uintptr_t addr, hw_reg_profile_kind kind) noexcept
+  {
+    const uintptr_t key = make_key (addr, kind);
+    for (std::size_t i = 0, h = hash (key); i < slot_count; ++i, h = (h + 1) & (slot_count - 1))
+    {
+      uintptr_t k = __atomic_load_n (&__slots[h].key, __ATOMIC_ACQUIRE);
+      if (k == 0 && __atomic_compare_exchange_n (&__slots[h].key, &k, key, false,
+						 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	return &__slots[h];
+      if (k == key)
+	return &__slots[h];
+    }
+    return nullptr;
+  }
+
+  // in address order.
+  template <typename F> static void for_each_slot (F f)
+  {
+    for (uintptr_t last = 0;;)
+    {
+      const hw_reg_profile_slot* next = nullptr;
+      for (std::size_t i = 0; i < slot_count; ++i)
+      {
+	const uintptr_t k = __atomic_load_n (&__slots[i].key, __ATOMIC_ACQUIRE);
+	if (k > last && (next == nullptr || k < next->key))
+	  next = &__slots[i];
+      }
+      if (next == nullptr)
+	return;
+      f (*next);
+      last = next->key;
+    }
+  }
+
+  static hw_reg_profile_slot __slots[slot_count];
+  static uint64_t __dropped;
+};
+
+template <typename Dummy> hw_reg_profile_slot hw_reg_profile_t<Dummy>::__slots[hw_reg_profile_t<Dummy>::slot_count];
+template <typename Dummy> uint64_t hw_reg_profile_t<Dummy>::__dropped;
+
+typedef hw_reg_profile_t<> hw_reg_profile;
+
+// measures the lifetime of the object, i.e. the register access in the
+// statement that creates it.
+class hw_reg_profile_scope
+{
+public:
+  hw_reg_profile_scope (const volatile void* addr, hw_reg_profile_kind kind) noexcept
+    : __addr (addr), __kind (kind), __start (hw_reg_profile_begin ())
+  { }
+
+  ~hw_reg_profile_scope (void)
+  {
+    hw_reg_profile::record (__addr, __kind, hw_reg_profile_end () - __start);
+  }
+
+  hw_reg_profile_scope (const hw_reg_profile_scope&) = delete;
+  hw_reg_profile_scope& operator = (const hw_reg_profile_scope&) = delete;
+
+private:
+  const volatile void* __addr;
+  hw_reg_profile_kind __kind;
+  uint64_t __start;
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_PROFILE_HEADER_INCLUDED__
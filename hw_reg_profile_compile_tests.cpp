@@ -0,0 +1,143 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register access profiler tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_profile_compile_tests.cpp
+
+The profiled registers are ordinary memory register blocks.  The resulting
+executable prints the profile and returns a non-zero exit code if a test
+fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#define __HW_REG_ENABLE_PROFILING__
+#include "hw_reg.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace test_namespace;
+
+struct regs
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_r	<uint32_t> status;
+  hw_reg_w	<uint32_t> data;
+  hw_reg_w	<uint32_t, void, hw_reg_single_owner, hw_reg_caps_byte_writable> fifo_ctrl;
+};
+
+typedef hw_reg_field<decltype (regs::fifo_ctrl), 8, 8> fifo_thr;	// narrow store
+
+int test_00 (regs& r)
+{
+  return r.status;		// timestamps around the volatile load
+}
+
+static bool check_histogram (void)
+{
+  typedef hw_reg_profile_histogram hist;
+
+  for (uint64_t v = 0; v < 100000; v = v * 3 / 2 + 1)
+  {
+    const unsigned b = hist::bucket_of (v);
+    if (hist::bucket_floor (b) > v || (b + 1 < hist::bucket_count && hist::bucket_floor (b + 1) <= v))
+      return false;
+  }
+  if (hist::bucket_of (~uint64_t (0)) != hist::bucket_count - 1)
+    return false;
+
+  // 70 and 75 are in the bucket [64,80), the percentiles are clamped to the
+  // recorded range instead of reporting the bucket bound.
+  static hist h;
+  h.record (75);
+  h.record (70);
+  h.record (75);
+  return h.percentile (0) == 70 && h.percentile (0.5) == 70 && h.percentile (1) == 75;
+}
+
+static bool check_profile (void)
+{
+  regs r;
+  *(&r.status) = 0;
+  hw_reg_profile::reset ();
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    r.ctrl |= 1;
+    r.data = r.status;
+  }
+
+  const hw_reg_profile_histogram* ctrl_r = hw_reg_profile::histogram (&r.ctrl, HW_REG_PROFILE_READ);
+  const hw_reg_profile_histogram* ctrl_w = hw_reg_profile::histogram (&r.ctrl, HW_REG_PROFILE_WRITE);
+  const hw_reg_profile_histogram* status_r = hw_reg_profile::histogram (&r.status, HW_REG_PROFILE_READ);
+  const hw_reg_profile_histogram* data_w = hw_reg_profile::histogram (&r.data, HW_REG_PROFILE_WRITE);
+
+  if (ctrl_r == nullptr || ctrl_w == nullptr || status_r == nullptr || data_w == nullptr)
+    return false;
+  if (hw_reg_profile::histogram (&r.status, HW_REG_PROFILE_WRITE) != nullptr)
+    return false;
+  if (ctrl_r->count != 1000 || ctrl_w->count != 1000 || status_r->count != 1000 || data_w->count != 1000)
+    return false;
+  if (status_r->min_value () > status_r->percentile (0.5) || status_r->percentile (0.5) > status_r->max)
+    return false;
+
+  std::ostringstream json;
+  hw_reg_profile::dump_json (json);
+  if (json.str ().find ("\"op\":\"write\",\"count\":1000") == std::string::npos)
+    return false;
+
+  // narrow stores of fields are profiled as writes of the register.
+  fifo_thr::set (r.fifo_ctrl, 4);
+  const hw_reg_profile_histogram* fifo_w = hw_reg_profile::histogram (&r.fifo_ctrl, HW_REG_PROFILE_WRITE);
+  if (fifo_w == nullptr || fifo_w->count != 1)
+    return false;
+
+  hw_reg_profile::dump_text (std::cout);
+  return hw_reg_profile::dropped () == 0;
+}
+
+int main (void)
+{
+  if (!check_histogram ())
+    return 1;
+  if (!check_profile ())
+    return 2;
+  return 0;
+}
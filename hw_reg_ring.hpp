@@ -0,0 +1,249 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register descriptor ring C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The descriptor ring template class implements the producer side of a typical
+DMA descriptor ring.  The descriptors live in normal (DMA-able) memory,
+while the ring indices are hardware registers:
+
+  - the tail / doorbell register is written by the CPU to tell the device
+    how far the ring has been filled.
+  - the head register is advanced by the device when it has finished
+    processing descriptors.
+
+Writing the doorbell register for every single descriptor is expensive.
+The ring thus separates filling descriptors (push) from notifying the device
+(kick).  Any number of descriptors can be pushed and then made visible to
+the device with a single doorbell write.  Before the doorbell write a DMA
+write barrier is issued, so that the descriptor contents are visible to the
+device before it sees the new tail index.  Likewise, a DMA read barrier is
+issued after reading the head register, before the completed descriptors
+are read.
+
+A C++ release fence is not sufficient for this, see the DMA barriers in
+hw_reg.hpp.
+
+Completed descriptors are reaped with reap.  The hardware head register is
+read only when all completions known from the previous head register read
+have been reaped.
+
+Example usage:
+
+  struct dma_regs
+  {
+    hw_reg_w<uint32_t> tx_tail;		// doorbell
+    hw_reg_r<uint32_t> tx_head;		// advanced by the device
+  };
+
+  hw_desc_ring<tx_desc, 256, hw_reg_w<uint32_t>, hw_reg_r<uint32_t>>
+    ring (tx_descs, regs.tx_tail, regs.tx_head);
+
+  for (auto& p : packets)
+    ring.push (make_desc (p));
+  ring.kick ();				// one MMIO write for all packets
+
+  ring.reap ([] (tx_desc& d) { free_buffer (d); });
+
+The ring size must be a power of two.  The register index values are the
+ring slot numbers, i.e. free-running indices modulo the ring size.  One ring
+slot is always kept empty, so that a full ring can be told apart from an
+empty one by looking at the index registers.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_RING_HEADER_INCLUDED__
+#define __HWREG_RING_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <memory>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+template <typename D, unsigned N, typename TailReg, typename HeadReg> class hw_desc_ring
+{
+public:
+  typedef D desc_type;
+  typedef typename TailReg::base_type index_type;
+
+  static constexpr unsigned size = N;
+  static constexpr unsigned capacity = N - 1;
+  static constexpr unsigned mask = N - 1;
+
+  static_assert (N >= 2 && (N & (N - 1)) == 0, "hw_desc_ring size must be a power of two");
+  static_assert (std::is_integral<index_type>::value
+		 && std::is_integral<typename HeadReg::base_type>::value
+		 , "hw_desc_ring index registers must be of integral type");
+
+  hw_desc_ring (D* descs, TailReg& tail, const HeadReg& head) noexcept
+    : __desc (descs), __tail (std::addressof (tail)), __head (std::addressof (head)),
+      __prod (0), __kicked (0), __reaped (0), __hw_head (0)
+  { }
+
+  hw_desc_ring (const hw_desc_ring&) = delete;
+  hw_desc_ring& operator = (const hw_desc_ring&) = delete;
+
+  // number of descriptors that can be pushed before the ring is full.
+  // this only considers completions that have been reaped already.
+  unsigned free_count (void) const noexcept { return capacity - (__prod - __reaped); }
+
+  // number of descriptors that have been pushed but not kicked yet.
+  unsigned staged_count (void) const noexcept { return __prod - __kicked; }
+
+  // number of descriptors that have been pushed but not reaped yet.
+  unsigned in_flight_count (void) const noexcept { return __prod - __reaped; }
+
+  bool empty (void) const noexcept { return __prod == __reaped; }
+  bool full (void) const noexcept { return free_count () == 0; }
+
+  // place a descriptor into the ring without notifying the device.
+  // returns false if the ring is full.
+  bool push (const D& d) noexcept
+  {
+    if (full ())
+      return false;
+
+    __desc[__prod & mask] = d;
+    ++__prod;
+    return true;
+  }
+
+  // place up to n descriptors into the ring without notifying the device.
+  // returns the number of descriptors that have been placed.
+  std::size_t push_n (const D* d, std::size_t n) noexcept
+  {
+    const std::size_t count = n < free_count () ? n : free_count ();
+    for (std::size_t i = 0; i < count; ++i)
+      __desc[(__prod + i) & mask] = d[i];
+    __prod += count;
+    return count;
+  }
+
+  // make all pushed descriptors visible to the device with a single
+  // doorbell write.  returns false if there was nothing to kick.
+  bool kick (void) noexcept
+  {
+    if (__prod == __kicked)
+      return false;
+
+    __HW_REG_DMA_WMB__ ();
+    *__tail = static_cast<index_type> (__prod & mask);
+    __kicked = __prod;
+    return true;
+  }
+
+  // push a single descriptor and kick it immediately.
+  bool push_kick (const D& d) noexcept
+  {
+    return push (d) && kick ();
+  }
+
+  // call f (D&) for up to max_count completed descriptors in ring order and
+  // release their slots.  returns the number of reaped descriptors.
+  template <typename F> unsigned reap (F&& f, unsigned max_count = N)
+  {
+    unsigned avail = __hw_head - __reaped;
+    if (avail == 0)
+      avail = refresh_head ();
+
+    const unsigned count = avail < max_count ? avail : max_count;
+    for (unsigned i = 0; i < count; ++i)
+      f (__desc[(__reaped + i) & mask]);
+
+    __reaped += count;
+    return count;
+  }
+
+  // release completed descriptor slots without looking at them.
+  unsigned reap (void)
+  {
+    return reap ([] (D&) { });
+  }
+
+private:
+  // read the hardware head register and convert it into a free-running
+  // index.  the device can never be ahead of the last kicked index.
+  unsigned refresh_head (void)
+  {
+    const unsigned h = static_cast<unsigned> (__head->read ());
+    __HW_REG_DMA_RMB__ ();
+
+    const unsigned done = (h - __reaped) & mask;
+    __hw_head = __reaped + (done <= __kicked - __reaped ? done : 0);
+    return __hw_head - __reaped;
+  }
+
+  D* const __desc;
+  TailReg* const __tail;
+  const HeadReg* const __head;
+
+  unsigned __prod;	// next slot to be filled
+  unsigned __kicked;	// value of __prod at the last doorbell write
+  unsigned __reaped;	// next slot to be reaped
+  unsigned __hw_head;	// last known device head, free-running
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_RING_HEADER_INCLUDED__
@@ -0,0 +1,191 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register descriptor ring compile-time tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 -pthread hw_reg_ring_compile_tests.cpp
+
+The device is simulated by a thread that shares the register block and the
+descriptors with the driver.  The resulting executable returns a non-zero
+exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_ring.hpp"
+
+#include <thread>
+#include <atomic>
+
+using namespace test_namespace;
+
+struct dma_regs
+{
+  hw_reg_w	<uint32_t> tail;	// doorbell, written by the driver
+  hw_reg_r	<uint32_t> head;	// advanced by the device
+};
+
+struct desc
+{
+  uint32_t data;
+  uint32_t result;
+};
+
+static constexpr unsigned ring_size = 64;
+
+typedef hw_desc_ring<desc, ring_size, hw_reg_w<uint32_t>, hw_reg_r<uint32_t>> ring_type;
+
+// typedef hw_desc_ring<desc, 48, hw_reg_w<uint32_t>, hw_reg_r<uint32_t>> bad_ring;
+// NG: compile time error, size is not a power of two
+
+bool test_00 (ring_type& r, const desc& d)
+{
+  return r.push (d);		// no MMIO access
+}
+
+bool test_01 (ring_type& r)
+{
+  return r.kick ();		// a single doorbell write
+}
+
+unsigned test_02 (ring_type& r)
+{
+  return r.reap ();
+}
+
+// the simulated device consumes descriptors between its head and the tail
+// doorbell value and advances the head register.
+struct device_model
+{
+  dma_regs& regs;
+  desc* descs;
+  std::atomic<bool> stop;
+  unsigned doorbells_seen;
+
+  void operator () (void)
+  {
+    volatile uint32_t* tail = &regs.tail;
+    volatile uint32_t* head = &regs.head;
+    uint32_t last_tail = 0;
+
+    while (!stop.load (std::memory_order_relaxed))
+    {
+      const uint32_t t = *tail;
+      if (t == last_tail)
+      {
+	std::this_thread::yield ();
+	continue;
+      }
+
+      ++doorbells_seen;
+      last_tail = t;
+      std::atomic_thread_fence (std::memory_order_acquire);
+
+      for (uint32_t h = *head; h != t; h = (h + 1) % ring_size)
+	descs[h].result = descs[h].data * 2;
+
+      std::atomic_thread_fence (std::memory_order_release);
+      *head = t;
+    }
+  }
+};
+
+int test_03 (void)
+{
+  static dma_regs regs;
+  static desc descs[ring_size];
+
+  device_model dev { regs, descs, { false }, 0 };
+  std::thread dev_thread (std::ref (dev));
+
+  ring_type ring (descs, regs.tail, regs.head);
+
+  const unsigned total = 10000;
+  const unsigned batch = 16;
+  unsigned pushed = 0;
+  unsigned reaped = 0;
+  unsigned kicks = 0;
+  uint64_t sum = 0;
+
+  while (reaped < total)
+  {
+    for (unsigned i = 0; i < batch && pushed < total; ++i)
+    {
+      if (!ring.push (desc { pushed, 0 }))
+	break;
+      ++pushed;
+    }
+
+    kicks += ring.kick ();
+    reaped += ring.reap ([&] (desc& d) { sum += d.result; });
+  }
+
+  dev.stop = true;
+  dev_thread.join ();
+
+  if (sum != uint64_t (total - 1) * total)
+    return 1;
+  if (kicks > (total + batch - 1) / batch * 2)
+    return 2;
+  return ring.empty () ? 0 : 3;
+}
+
+int test_04 (void)
+{
+  // without device progress the ring fills up to capacity.
+  static dma_regs regs;
+  static desc descs[ring_size];
+  ring_type ring (descs, regs.tail, regs.head);
+
+  unsigned n = 0;
+  while (ring.push (desc { n, 0 }))
+    ++n;
+
+  if (n != ring_type::capacity || ring.kick () != true || ring.kick () != false)
+    return 1;
+
+  return ring.reap () == 0 ? 0 : 2;
+}
+
+int main (void)
+{
+  if (int r = test_03 ())
+    return r;
+  if (int r = test_04 ())
+    return 10 + r;
+  return 0;
+}
@@ -0,0 +1,276 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register block shadow C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The register block shadow is a transactional layer over a register block.
+Register values are staged in memory and written to the device in one go
+with commit.  Only registers whose staged value differs from the last
+committed value are written, in ascending address order.  This avoids
+rewriting a whole block when reconfiguring a few fields.
+
+Example usage:
+
+  struct mac_regs
+  {
+    hw_reg_rw<uint32_t> ctrl;
+    hw_reg_rw<uint32_t> filter[16];
+    hw_reg_w<uint32_t> apply;
+  };
+
+  hw_reg_shadow<mac_regs> sh (regs);
+
+  sh.load (regs.ctrl);			// read current value from the device
+  sh.init (regs.apply, 0);		// write-only, set known value
+  sh.commit_last (regs.apply);		// always write after all others
+
+  sh.modify (regs.ctrl, 0x0F, 0x03);
+  sh.stage (regs.filter[3], addr);
+  sh.stage (regs.apply, 1);
+  sh.commit ();				// writes ctrl, filter[3], apply
+
+The registers of the block must all have the shadow word type (uint32_t by
+default).  Dirty registers are tracked in a bitmap, thus commit costs one
+bit scan per dirty register.
+
+The shadow does not know the device values initially.  Registers that have
+been neither loaded nor initialized are unknown and a staged value is always
+written by the next commit, even if it is zero.  Modifying an unknown
+register modifies the value staged so far, which is zero if nothing has been
+staged.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_SHADOW_HEADER_INCLUDED__
+#define __HWREG_SHADOW_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <memory>
+#include <cassert>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+template <typename Block, typename T = uint32_t> class hw_reg_shadow
+{
+public:
+  typedef T value_type;
+
+  static constexpr std::size_t size = sizeof (Block) / sizeof (T);
+
+private:
+  static constexpr std::size_t bitmap_words = (size + 63) / 64;
+
+public:
+  static_assert (std::is_integral<T>::value, "hw_reg_shadow word type must be integral");
+  static_assert (sizeof (Block) % sizeof (T) == 0
+		 , "hw_reg_shadow block size must be a multiple of the word size");
+
+  explicit hw_reg_shadow (Block& hw) noexcept
+    : __base (reinterpret_cast<volatile T*> (std::addressof (hw)))
+  {
+    for (std::size_t i = 0; i < size; ++i)
+      __committed[i] = __staged[i] = 0;
+    for (std::size_t i = 0; i < bitmap_words; ++i)
+    {
+      __dirty[i] = __late[i] = 0;
+      __unknown[i] = ~uint64_t (0);
+    }
+  }
+
+  hw_reg_shadow (const hw_reg_shadow&) = delete;
+  hw_reg_shadow& operator = (const hw_reg_shadow&) = delete;
+
+  // set the shadow value of a register without writing it, e.g. to its
+  // reset default.
+  template <typename Reg> void init (const Reg& reg, const T& value) noexcept
+  {
+    const std::size_t i = index_of (reg);
+    __committed[i] = __staged[i] = value;
+    clear_bit (__dirty, i);
+    clear_bit (__unknown, i);
+  }
+
+  // set the shadow value of a register by reading it from the device.
+  template <typename Reg> void load (const Reg& reg)
+  {
+    static_assert (Reg::readable, "hw_reg_shadow cannot load a write-only register");
+    init (reg, reg.read ());
+  }
+
+  // staged value of a register.
+  template <typename Reg> T get (const Reg& reg) const noexcept
+  {
+    return __staged[index_of (reg)];
+  }
+
+  template <typename Reg> void stage (const Reg& reg, const T& value) noexcept
+  {
+    static_assert (Reg::writable, "hw_reg_shadow cannot stage a read-only register");
+    const std::size_t i = index_of (reg);
+    __staged[i] = value;
+    if (__staged[i] != __committed[i] || test_bit (__unknown, i))
+      set_bit (__dirty, i);
+    else
+      clear_bit (__dirty, i);
+  }
+
+  template <typename Reg> void modify (const Reg& reg, const T& mask, const T& value) noexcept
+  {
+    stage (reg, (get (reg) & ~mask) | value);
+  }
+
+  // ordering constraint: the register is written after all other dirty
+  // registers of a commit, e.g. a register that applies the configuration.
+  template <typename Reg> void commit_last (const Reg& reg, bool last = true) noexcept
+  {
+    if (last)
+      set_bit (__late, index_of (reg));
+    else
+      clear_bit (__late, index_of (reg));
+  }
+
+  std::size_t dirty_count (void) const noexcept
+  {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < bitmap_words; ++i)
+      c += __builtin_popcountll (__dirty[i]);
+    return c;
+  }
+
+  bool dirty (void) const noexcept
+  {
+    for (std::size_t i = 0; i < bitmap_words; ++i)
+      if (__dirty[i] != 0)
+	return true;
+    return false;
+  }
+
+  // drop all staged changes.  unknown registers stay unknown.
+  void discard (void) noexcept
+  {
+    for (std::size_t i = 0; i < size; ++i)
+      __staged[i] = __committed[i];
+    for (std::size_t i = 0; i < bitmap_words; ++i)
+      __dirty[i] = 0;
+  }
+
+  // write all changed registers in ascending address order, followed by
+  // the changed registers that are marked with commit_last, again in
+  // ascending address order.  returns the number of register writes.
+  std::size_t commit (void) noexcept
+  {
+    std::size_t writes = 0;
+
+    for (std::size_t w = 0; w < bitmap_words; ++w)
+      writes += commit_word (w, __dirty[w] & ~__late[w]);
+
+    for (std::size_t w = 0; w < bitmap_words; ++w)
+      writes += commit_word (w, __dirty[w] & __late[w]);
+
+    for (std::size_t w = 0; w < bitmap_words; ++w)
+      __dirty[w] = 0;
+
+    return writes;
+  }
+
+private:
+  template <typename Reg> std::size_t index_of (const Reg& reg) const noexcept
+  {
+    static_assert (sizeof (typename Reg::base_type) == sizeof (T)
+		   , "hw_reg_shadow registers must have the shadow word size");
+
+    const std::size_t i = reinterpret_cast<const volatile T*> (std::addressof (reg)) - __base;
+    assert (i < size && "hw_reg_shadow register is not a member of the block");
+    return i;
+  }
+
+  static bool test_bit (const uint64_t* bits, std::size_t i) noexcept { return (bits[i / 64] >> (i % 64)) & 1; }
+  static void set_bit (uint64_t* bits, std::size_t i) noexcept { bits[i / 64] |= uint64_t (1) << (i % 64); }
+  static void clear_bit (uint64_t* bits, std::size_t i) noexcept { bits[i / 64] &= ~(uint64_t (1) << (i % 64)); }
+
+  std::size_t commit_word (std::size_t w, uint64_t bits) noexcept
+  {
+    const uint64_t bits_written = bits;
+    std::size_t writes = 0;
+    for (; bits != 0; bits &= bits - 1, ++writes)
+    {
+      const std::size_t i = w * 64 + __builtin_ctzll (bits);
+      __base[i] = __staged[i];
+      __committed[i] = __staged[i];
+    }
+    __unknown[w] &= ~bits_written;
+    return writes;
+  }
+
+  volatile T* const __base;
+  T __committed[size];
+  T __staged[size];
+  uint64_t __dirty[bitmap_words];
+  uint64_t __late[bitmap_words];
+  uint64_t __unknown[bitmap_words];	// neither loaded, initialized nor committed
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_SHADOW_HEADER_INCLUDED__
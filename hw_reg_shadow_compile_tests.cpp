@@ -0,0 +1,122 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register block shadow compile-time tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_shadow_compile_tests.cpp
+
+The shadows are committed to ordinary memory register blocks.  The resulting
+executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_shadow.hpp"
+
+using namespace test_namespace;
+
+struct mac_regs
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_r	<uint32_t> status;
+  hw_reg_rw	<uint32_t> filter[100];
+  hw_reg_w	<uint32_t> apply;
+};
+
+void test_00 (hw_reg_shadow<mac_regs>& sh, mac_regs& r, uint32_t x)
+{
+  sh.stage (r.filter[3], x);
+//sh.stage (r.status, x);	// NG: compile time error, read-only register
+}
+
+uint32_t test_01 (hw_reg_shadow<mac_regs>& sh, mac_regs& r)
+{
+  return sh.get (r.ctrl);	// no MMIO access
+}
+
+int test_02 (void)
+{
+  static mac_regs r;
+  hw_reg_shadow<mac_regs> sh (r);
+
+  r.ctrl = 0x10;
+  sh.load (r.ctrl);
+  sh.init (r.apply, 0);
+  sh.init (r.filter[5], 0);
+  sh.commit_last (r.apply);
+
+  sh.stage (r.apply, 1);
+  sh.stage (r.filter[70], 0xAA);
+  sh.modify (r.ctrl, 0x0F, 0x03);
+  sh.stage (r.filter[5], 0);		// unchanged, not dirty
+
+  if (sh.dirty_count () != 3 || sh.get (r.ctrl) != 0x13)
+    return 1;
+
+  if (sh.commit () != 3 || sh.dirty ())
+    return 2;
+
+  if (r.ctrl != 0x13 || r.filter[70] != 0xAA || *(&r.apply) != 1)
+    return 3;
+
+  // staging the committed value again does not cause a write.
+  r.filter[70] = 0x55;
+  sh.stage (r.filter[70], 0xAA);
+  if (sh.commit () != 0 || r.filter[70] != 0x55)
+    return 4;
+
+  sh.stage (r.filter[1], 7);
+  sh.discard ();
+  if (sh.commit () != 0 || r.filter[1] != 0)
+    return 5;
+
+  // the device value of an unknown register may differ from the staged
+  // value, thus it is written even if the value is zero, but only once.
+  r.filter[9] = 0x77;
+  sh.stage (r.filter[9], 0);
+  if (sh.dirty_count () != 1 || sh.commit () != 1 || r.filter[9] != 0)
+    return 6;
+  sh.stage (r.filter[9], 0);
+  return sh.commit () == 0 ? 0 : 7;
+}
+
+int main (void)
+{
+  if (int r = test_02 ())
+    return r;
+  return 0;
+}
@@ -0,0 +1,258 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register block snapshot C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The register block snapshot saves the state of a register block into a
+compact buffer and restores it after a device reset or a suspend / resume
+cycle, without going through the high-level driver code again.
+
+The registers that make up the state are described by a constexpr table.
+The table order is the restore order, thus registers that depend on others
+(e.g. an enable bit that must be set last) are listed after them.
+Each entry also specifies the reset default value of the register:
+
+  struct uart_regs
+  {
+    hw_reg_rw<uint32_t> ctrl;
+    hw_reg_w<uint32_t> baud;		// write-only
+    hw_reg_r<uint32_t> status;
+    hw_reg_rw<uint32_t> irq_enable;
+  };
+
+  static constexpr hw_snap_reg uart_state[] =
+  {
+    hw_snap_entry<decltype (uart_regs::baud)> (offsetof (uart_regs, baud), 0),
+    hw_snap_entry<decltype (uart_regs::ctrl)> (offsetof (uart_regs, ctrl), 0),
+    hw_snap_entry<decltype (uart_regs::irq_enable)> (offsetof (uart_regs, irq_enable), 0)
+  };
+
+The access type of a register determines how its value is obtained:
+
+  - read-write registers are read when the snapshot is saved.
+  - write-only registers cannot be read back.  Their value must be recorded
+    in the snapshot's shadow whenever the driver writes them.
+  - read-only registers are never restored.  They are accepted in the table
+    to allow reusing complete register descriptions.
+
+When restoring, registers whose saved value equals their reset default are
+skipped, which is correct right after a device reset:
+
+  hw_reg_snapshot<3> snap (uart_state);
+  hw_init_mmio_bus bus (regs);
+
+  snap.shadow (offsetof (uart_regs, baud), divisor);	// when writing baud
+  snap.save (bus);					// before suspend
+  ...
+  snap.restore (bus);					// after reset / resume
+
+The accesses are done through the same bus objects as the ones used for
+initialization sequences, see hw_reg_init_seq.hpp.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_SNAPSHOT_HEADER_INCLUDED__
+#define __HWREG_SNAPSHOT_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "hw_reg_init_seq.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+enum hw_snap_access : uint8_t
+{
+  HW_SNAP_RW,		// saved by reading, restored by writing
+  HW_SNAP_W,		// saved from the shadow, restored by writing
+  HW_SNAP_R		// not saved, not restored
+};
+
+struct hw_snap_reg
+{
+  uintptr_t addr;		// register address or offset
+  uint32_t reset_value;
+  hw_snap_access access;
+};
+
+template <typename Reg> constexpr hw_snap_access hw_snap_access_of (void) noexcept
+{
+  static_assert (sizeof (typename Reg::base_type) == sizeof (uint32_t)
+		 , "hw_snap_reg supports 32-bit registers only");
+  return Reg::writable ? (Reg::readable ? HW_SNAP_RW : HW_SNAP_W) : HW_SNAP_R;
+}
+
+// entry for a register block member.  the access type is taken from the
+// register type.
+template <typename Reg>
+constexpr hw_snap_reg hw_snap_entry (uintptr_t offset, uint32_t reset_value) noexcept
+{
+  return hw_snap_reg { offset, reset_value, hw_snap_access_of<Reg> () };
+}
+
+// entry for a constant address register.
+template <typename Reg>
+constexpr auto hw_snap_entry (const Reg&, uint32_t reset_value) noexcept
+  -> decltype (hw_init_reg_addr<Reg>::value, hw_snap_reg ())
+{
+  return hw_snap_reg { hw_init_reg_addr<Reg>::value, reset_value, hw_snap_access_of<Reg> () };
+}
+
+// number of registers in a table that need a shadow.
+constexpr std::size_t hw_snap_shadow_count (const hw_snap_reg* map, std::size_t begin, std::size_t end) noexcept
+{
+  return end - begin == 0 ? 0
+	 : end - begin == 1 ? (map[begin].access == HW_SNAP_W ? 1 : 0)
+	 : hw_snap_shadow_count (map, begin, begin + (end - begin) / 2)
+	   + hw_snap_shadow_count (map, begin + (end - begin) / 2, end);
+}
+
+template <std::size_t N>
+constexpr std::size_t hw_snap_shadow_count (const hw_snap_reg (&map)[N]) noexcept
+{
+  return hw_snap_shadow_count (map, 0, N);
+}
+
+
+template <std::size_t N> class hw_reg_snapshot
+{
+public:
+  static constexpr std::size_t size = N;
+
+  explicit hw_reg_snapshot (const hw_snap_reg (&map)[N]) noexcept
+    : __map (map)
+  {
+    reset ();
+  }
+
+  // set all values to their reset defaults, e.g. after the device has been
+  // reset while the snapshot was not valid.
+  void reset (void) noexcept
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      __value[i] = __map[i].reset_value;
+  }
+
+  // record a write to the register at table index i.  this must be called
+  // for write-only registers whenever they are written.
+  void shadow_at (std::size_t i, uint32_t value) noexcept { __value[i] = value; }
+
+  // same as above, but look up the register by address.
+  // returns false if the register is not in the table.
+  bool shadow (uintptr_t addr, uint32_t value) noexcept
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      if (__map[i].addr == addr)
+      {
+	__value[i] = value;
+	return true;
+      }
+    return false;
+  }
+
+  // read all read-write registers.
+  template <typename Bus> void save (const Bus& bus) noexcept
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      if (__map[i].access == HW_SNAP_RW)
+	__value[i] = bus.read (__map[i].addr);
+  }
+
+  // write all registers whose value differs from the reset default, in table
+  // order.  returns the number of register writes.
+  template <typename Bus> std::size_t restore (Bus& bus) const
+  {
+    std::size_t writes = 0;
+    for (std::size_t i = 0; i < N; ++i)
+      if (__map[i].access != HW_SNAP_R && __value[i] != __map[i].reset_value)
+      {
+	bus.write (__map[i].addr, __value[i]);
+	++writes;
+      }
+    return writes;
+  }
+
+  // write all writable registers regardless of their reset defaults, e.g.
+  // when the device state is unknown.  returns the number of register writes.
+  template <typename Bus> std::size_t restore_all (Bus& bus) const
+  {
+    std::size_t writes = 0;
+    for (std::size_t i = 0; i < N; ++i)
+      if (__map[i].access != HW_SNAP_R)
+      {
+	bus.write (__map[i].addr, __value[i]);
+	++writes;
+      }
+    return writes;
+  }
+
+  uint32_t value_at (std::size_t i) const noexcept { return __value[i]; }
+  const uint32_t* data (void) const noexcept { return __value; }
+  const hw_snap_reg& entry (std::size_t i) const noexcept { return __map[i]; }
+
+private:
+  const hw_snap_reg* __map;
+  uint32_t __value[N];
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_SNAPSHOT_HEADER_INCLUDED__
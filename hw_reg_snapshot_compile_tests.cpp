@@ -0,0 +1,121 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register block snapshot compile-time tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_snapshot_compile_tests.cpp
+
+The snapshots are taken from and restored to ordinary memory register
+blocks.  The resulting executable returns a non-zero exit code if a test
+fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_snapshot.hpp"
+
+#include <cstddef>
+
+using namespace test_namespace;
+
+struct uart_regs
+{
+  hw_reg_rw	<uint32_t> ctrl;
+  hw_reg_w	<uint32_t> baud;	// write-only, needs a shadow
+  hw_reg_r	<uint32_t> status;	// read-only, not restored
+  hw_reg_rw	<uint32_t> irq_enable;
+  hw_reg_rw	<uint32_t> fifo_level;
+};
+
+// restore order: baud rate before enabling the UART.
+static constexpr hw_snap_reg g_uart_state[] =
+{
+  hw_snap_entry<decltype (uart_regs::baud)> (offsetof (uart_regs, baud), 0),
+  hw_snap_entry<decltype (uart_regs::fifo_level)> (offsetof (uart_regs, fifo_level), 8),
+  hw_snap_entry<decltype (uart_regs::irq_enable)> (offsetof (uart_regs, irq_enable), 0),
+  hw_snap_entry<decltype (uart_regs::status)> (offsetof (uart_regs, status), 0),
+  hw_snap_entry<decltype (uart_regs::ctrl)> (offsetof (uart_regs, ctrl), 0)
+};
+
+static_assert (g_uart_state[0].access == HW_SNAP_W, "write-only register");
+static_assert (g_uart_state[3].access == HW_SNAP_R, "read-only register");
+static_assert (g_uart_state[4].access == HW_SNAP_RW, "read-write register");
+static_assert (hw_snap_shadow_count (g_uart_state) == 1, "one register needs a shadow");
+
+static constexpr hw_reg_rw<uint32_t, const_addr<0xA0002000>> TIMER_CTRL;
+static constexpr hw_snap_reg g_timer_state[] = { hw_snap_entry (TIMER_CTRL, 0) };
+static_assert (g_timer_state[0].addr == 0xA0002000, "register address");
+
+int test_00 (void)
+{
+  uart_regs dev = { };
+  hw_init_mmio_bus bus (dev);
+  hw_reg_snapshot<5> snap (g_uart_state);
+
+  // driver configures the device
+  dev.baud = 115200;
+  snap.shadow (offsetof (uart_regs, baud), 115200);
+  dev.fifo_level = 8;
+  dev.irq_enable = 0x5;
+  dev.ctrl = 0x1;
+  *(&dev.status) = 0xFF;
+
+  snap.save (bus);
+
+  // device reset
+  *(&dev.ctrl) = 0;
+  *(&dev.baud) = 0;
+  *(&dev.status) = 0;
+  *(&dev.irq_enable) = 0;
+  *(&dev.fifo_level) = 8;
+
+  // fifo_level is at its reset default and not written, status is read-only.
+  if (snap.restore (bus) != 3)
+    return 1;
+
+  if (*(&dev.baud) != 115200 || dev.irq_enable != 0x5 || dev.ctrl != 0x1 || dev.status != 0)
+    return 2;
+
+  return snap.restore_all (bus) == 4 ? 0 : 3;
+}
+
+int main (void)
+{
+  if (int r = test_00 ())
+    return r;
+  return 0;
+}
@@ -0,0 +1,436 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register virtual device C++ template class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+It also uses the POSIX shared memory, eventfd and fork interfaces of Linux.
+
+Known to work:
+  GCC 12, libstdc++-v3, glibc 2.36
+
+--------------------------------------------------------------------------------
+
+The virtual device template class allows running a driver that is written
+against a hw_reg register block without the actual hardware.  The register
+block lives in POSIX shared memory (shm_open) and a device model process
+services it:
+
+  - the driver accesses the register block as usual.  it is placed at the
+    start of the shared memory mapping, which is page aligned like a real
+    register window.
+  - the driver notifies the device model with doorbell, e.g. after writing
+    a command register or a DMA ring tail register.
+  - the device model is a function that is called in a forked process after
+    every doorbell notification, or periodically if a poll timeout is given.
+    it updates status registers and can raise interrupts with raise_irq.
+  - the driver waits for interrupts with wait_irq, or adds irq_fd to its own
+    poll / epoll loop.
+
+Both notification channels are eventfds, which are inherited by the forked
+device model process.
+
+Example usage:
+
+  struct dev_regs
+  {
+    hw_reg_w<uint32_t> cmd;
+    hw_reg_r<uint32_t> status;
+  };
+
+  hw_vdev<dev_regs> dev;
+  dev.create ("/my_vdev");
+  dev.spawn ([] (dev_regs& r, hw_vdev<dev_regs>& d)
+  {
+    if (*(&r.cmd) != 0)
+    {
+      *(&r.status) = 1;
+      *(&r.cmd) = 0;
+      d.raise_irq ();
+    }
+  });
+
+  dev.regs ().cmd = 1;		// driver code, unchanged
+  dev.doorbell ();
+  dev.wait_irq ();
+  dev.stop ();
+
+Non-register data that the device accesses, such as DMA descriptors, can be
+placed into the register block struct as plain members, so that it is shared
+with the device model as well.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_VDEV_HEADER_INCLUDED__
+#define __HWREG_VDEV_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <type_traits>
+#include <atomic>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "hw_reg.hpp"
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+// eventfd based notification channel.  signals are counted, a wait returns
+// the number of signals since the last wait.
+class hw_vdev_event
+{
+public:
+  hw_vdev_event (void) noexcept : __fd (-1) { }
+  ~hw_vdev_event (void) { close (); }
+
+  hw_vdev_event (const hw_vdev_event&) = delete;
+  hw_vdev_event& operator = (const hw_vdev_event&) = delete;
+
+  bool open (void) noexcept
+  {
+    close ();
+    __fd = ::eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    return __fd >= 0;
+  }
+
+  void close (void) noexcept
+  {
+    if (__fd >= 0)
+      ::close (__fd);
+    __fd = -1;
+  }
+
+  int fd (void) const noexcept { return __fd; }
+
+  void signal (uint64_t n = 1) const noexcept
+  {
+    while (::write (__fd, &n, sizeof (n)) < 0 && errno == EINTR)
+      ;
+  }
+
+  // wait for at least one signal.  timeout_ms < 0 waits forever.
+  // returns the number of signals, or 0 on timeout.
+  uint64_t wait (int timeout_ms = -1) const noexcept
+  {
+    for (;;)
+    {
+      const uint64_t n = try_wait ();
+      if (n != 0)
+	return n;
+
+      pollfd p = { __fd, POLLIN, 0 };
+      const int r = ::poll (&p, 1, timeout_ms);
+      if (r == 0)
+	return 0;
+      if (r < 0 && errno != EINTR)
+	return 0;
+    }
+  }
+
+  // returns the number of signals without waiting.
+  uint64_t try_wait (void) const noexcept
+  {
+    uint64_t n = 0;
+    while (::read (__fd, &n, sizeof (n)) < 0)
+      if (errno != EINTR)
+	return 0;
+    return n;
+  }
+
+private:
+  int __fd;
+};
+
+template <typename Block> class hw_vdev
+{
+public:
+  typedef Block block_type;
+
+  static_assert (std::is_trivially_destructible<Block>::value
+		 , "hw_vdev register block must be trivially destructible");
+
+  hw_vdev (void) noexcept
+    : __shared (nullptr), __map_size (0), __owner (false), __model_pid (-1)
+  {
+    __name[0] = '\0';
+  }
+
+  ~hw_vdev (void) { close (); }
+
+  hw_vdev (const hw_vdev&) = delete;
+  hw_vdev& operator = (const hw_vdev&) = delete;
+
+  // create a new shared memory object with a zero filled register block and
+  // the notification channels.  returns false on failure, errno is set.
+  bool create (const char* name) noexcept
+  {
+    close ();
+    const int fd = ::shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+      return false;
+
+    __owner = true;
+    copy_name (name);
+
+    const bool mapped = ::ftruncate (fd, sizeof (shared_block)) == 0 && map (fd);
+    close_fd (fd);
+
+    if (!mapped || !__doorbell.open () || !__irq.open ())
+    {
+      close ();
+      return false;
+    }
+    return true;
+  }
+
+  // map an existing shared memory object, e.g. to inspect the registers from
+  // another process.  there are no notification channels in this case.
+  bool attach (const char* name) noexcept
+  {
+    close ();
+    const int fd = ::shm_open (name, O_RDWR, 0);
+    if (fd < 0)
+      return false;
+
+    const bool mapped = map (fd);
+    close_fd (fd);
+
+    if (!mapped)
+    {
+      close ();
+      return false;
+    }
+    return true;
+  }
+
+  // stop the device model process, if any, and unmap the shared memory
+  // object.  the creator also removes it.
+  void close (void) noexcept
+  {
+    stop ();
+    if (__shared != nullptr)
+      ::munmap (__shared, __map_size);
+    if (__owner)
+      ::shm_unlink (__name);
+
+    __shared = nullptr;
+    __map_size = 0;
+    __owner = false;
+    __name[0] = '\0';
+    __doorbell.close ();
+    __irq.close ();
+  }
+
+  bool valid (void) const noexcept { return __shared != nullptr; }
+
+  Block& regs (void) noexcept { return __shared->regs; }
+  const Block& regs (void) const noexcept { return __shared->regs; }
+
+  // start the device model in a forked process.  model (Block&, hw_vdev&) is
+  // called after every doorbell notification and, if poll_timeout_ms is not
+  // negative, when no notification arrives within the timeout.  a timeout of
+  // 0 busy polls the registers.  returns the process id or -1.
+  template <typename Model> pid_t spawn (Model model, int poll_timeout_ms = -1)
+  {
+    if (!valid () || __model_pid > 0)
+      return -1;
+
+    __shared->stop.store (false, std::memory_order_relaxed);
+
+    const pid_t pid = ::fork ();
+    if (pid != 0)
+    {
+      __model_pid = pid;
+      return pid;
+    }
+
+    // device model process.  it must not return into the caller or unwind
+    // into the driver code, thus an exception of the model terminates the
+    // process as well.
+    int exit_code = 0;
+    try
+    {
+      while (!__shared->stop.load (std::memory_order_acquire))
+      {
+	if (poll_timeout_ms == 0)
+	  __doorbell.try_wait ();
+	else
+	  __doorbell.wait (poll_timeout_ms);
+
+	if (__shared->stop.load (std::memory_order_acquire))
+	  break;
+
+	std::atomic_thread_fence (std::memory_order_acquire);
+	model (__shared->regs, *this);
+	std::atomic_thread_fence (std::memory_order_release);
+      }
+    }
+    catch (...)
+    {
+      exit_code = 1;
+    }
+    ::_exit (exit_code);
+  }
+
+  // stop the device model process and wait for it.
+  // returns false if there is no device model process.
+  bool stop (void) noexcept
+  {
+    if (__model_pid <= 0)
+      return false;
+
+    if (__shared != nullptr)
+    {
+      __shared->stop.store (true, std::memory_order_release);
+      __doorbell.signal ();
+    }
+    else
+      ::kill (__model_pid, SIGKILL);
+
+    int status;
+    while (::waitpid (__model_pid, &status, 0) < 0 && errno == EINTR)
+      ;
+    __model_pid = -1;
+    return true;
+  }
+
+  pid_t model_pid (void) const noexcept { return __model_pid; }
+
+  // driver -> device notification.
+  void doorbell (void) const noexcept
+  {
+    std::atomic_thread_fence (std::memory_order_release);
+    __doorbell.signal ();
+  }
+
+  // device -> driver notification.
+  void raise_irq (void) const noexcept
+  {
+    std::atomic_thread_fence (std::memory_order_release);
+    __irq.signal ();
+  }
+
+  // wait for interrupts.  returns the number of interrupts raised since the
+  // last wait, or 0 on timeout.
+  uint64_t wait_irq (int timeout_ms = -1) const noexcept
+  {
+    const uint64_t n = __irq.wait (timeout_ms);
+    std::atomic_thread_fence (std::memory_order_acquire);
+    return n;
+  }
+
+  int doorbell_fd (void) const noexcept { return __doorbell.fd (); }
+  int irq_fd (void) const noexcept { return __irq.fd (); }
+
+private:
+  struct shared_block
+  {
+    Block regs;
+    alignas (64) std::atomic<bool> stop;
+  };
+
+  // close a descriptor without changing errno of a preceding failure.
+  static void close_fd (int fd) noexcept
+  {
+    const int e = errno;
+    ::close (fd);
+    errno = e;
+  }
+
+  // the caller closes fd, the mapping does not need it.
+  bool map (int fd) noexcept
+  {
+    struct stat st;
+    if (::fstat (fd, &st) != 0 || static_cast<std::size_t> (st.st_size) < sizeof (shared_block))
+    {
+      errno = EINVAL;
+      return false;
+    }
+
+    void* p = ::mmap (nullptr, sizeof (shared_block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      return false;
+
+    __shared = static_cast<shared_block*> (p);
+    __map_size = sizeof (shared_block);
+    return true;
+  }
+
+  void copy_name (const char* name) noexcept
+  {
+    std::size_t i = 0;
+    for (; name[i] != '\0' && i < sizeof (__name) - 1; ++i)
+      __name[i] = name[i];
+    __name[i] = '\0';
+  }
+
+  shared_block* __shared;
+  std::size_t __map_size;
+  bool __owner;
+  pid_t __model_pid;
+  char __name[256];
+  hw_vdev_event __doorbell;
+  hw_vdev_event __irq;
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_VDEV_HEADER_INCLUDED__
@@ -0,0 +1,244 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register virtual device tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_vdev_compile_tests.cpp
+
+The device models run in forked processes and share the register blocks with
+the driver code through POSIX shared memory.  The resulting executable
+returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_vdev.hpp"
+#include "hw_reg_ring.hpp"
+
+#include <cstdio>
+
+using namespace test_namespace;
+
+// command / status register device
+struct calc_regs
+{
+  hw_reg_w	<uint32_t> arg;
+  hw_reg_w	<uint32_t> cmd;		// 1 = square arg
+  hw_reg_r	<uint32_t> result;
+  hw_reg_r	<uint32_t> done_count;
+};
+
+static void calc_model (calc_regs& r, hw_vdev<calc_regs>& dev)
+{
+  if (*(&r.cmd) != 1)
+    return;
+
+  const uint32_t a = *(&r.arg);
+  *(&r.result) = a * a;
+  *(&r.cmd) = 0;
+  *(&r.done_count) = *(&r.done_count) + 1;
+  dev.raise_irq ();
+}
+
+static bool check_calc (const char* name)
+{
+  hw_vdev<calc_regs> dev;
+  if (!dev.create (name) || dev.spawn (calc_model) <= 0)
+    return false;
+
+  calc_regs& r = dev.regs ();
+  for (uint32_t i = 1; i <= 100; ++i)
+  {
+    r.arg = i;
+    r.cmd = 1;
+    dev.doorbell ();
+    if (dev.wait_irq (5000) == 0 || r.result != i * i)
+      return false;
+  }
+
+  return r.done_count == 100 && dev.stop ();
+}
+
+// DMA ring device.  the descriptors are part of the shared block.
+static constexpr unsigned ring_size = 32;
+
+struct desc
+{
+  uint32_t data;
+  uint32_t result;
+};
+
+struct dma_regs
+{
+  hw_reg_w	<uint32_t> tail;
+  hw_reg_r	<uint32_t> head;
+  desc descs[ring_size];
+};
+
+typedef hw_desc_ring<desc, ring_size, hw_reg_w<uint32_t>, hw_reg_r<uint32_t>> ring_type;
+
+// processes descriptors up to the tail register.  polls every millisecond in
+// addition to the doorbell.
+static void dma_model (dma_regs& r, hw_vdev<dma_regs>& dev)
+{
+  uint32_t h = *(&r.head);
+  const uint32_t t = *(&r.tail);
+  if (h == t)
+    return;
+
+  for (; h != t; h = (h + 1) % ring_size)
+    r.descs[h].result = r.descs[h].data + 1;
+
+  std::atomic_thread_fence (std::memory_order_release);
+  *(&r.head) = h;
+  dev.raise_irq ();
+}
+
+static bool check_dma (const char* name)
+{
+  hw_vdev<dma_regs> dev;
+  if (!dev.create (name) || dev.spawn (dma_model, 1) <= 0)
+    return false;
+
+  ring_type ring (dev.regs ().descs, dev.regs ().tail, dev.regs ().head);
+
+  const uint32_t total = 1000;
+  uint32_t sent = 0, received = 0;
+  bool ok = true;
+
+  while (received < total)
+  {
+    while (sent < total && ring.push (desc { sent, 0 }))
+      ++sent;
+    if (ring.kick ())
+      dev.doorbell ();
+
+    if (ring.in_flight_count () != 0 && dev.wait_irq (5000) == 0)
+      return false;
+
+    ring.reap ([&] (desc& d)
+    {
+      ok &= d.data == received && d.result == received + 1;
+      ++received;
+    });
+  }
+
+  return ok && dev.stop ();
+}
+
+static bool check_attach (const char* name)
+{
+  hw_vdev<calc_regs> dev;
+  if (!dev.create (name))
+    return false;
+
+  dev.regs ().arg = 1234;
+
+  hw_vdev<calc_regs> other;
+  if (!other.attach (name))
+    return false;
+
+  if (*(&other.regs ().arg) != 1234 || other.irq_fd () >= 0)
+    return false;
+
+  // a failed attach does not leak the shared memory descriptor.  the next
+  // descriptor gets the lowest free number.
+  char empty_name[80];
+  std::snprintf (empty_name, sizeof (empty_name), "%s_empty", name);
+  const int empty_fd = ::shm_open (empty_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (empty_fd < 0)
+    return false;
+  ::close (empty_fd);
+
+  const int fd0 = ::dup (0);
+  ::close (fd0);
+  hw_vdev<calc_regs> empty;
+  const bool attached = empty.attach (empty_name);
+  ::shm_unlink (empty_name);
+  const int fd1 = ::dup (0);
+  ::close (fd1);
+  return !attached && fd1 == fd0;
+}
+
+static void throwing_model (calc_regs& r, hw_vdev<calc_regs>&)
+{
+  if (*(&r.cmd) == 2)
+    throw 1;
+}
+
+static bool check_close (const char* name)
+{
+  hw_vdev<calc_regs> dev;
+  if (!dev.create (name) || dev.spawn (calc_model) <= 0)
+    return false;
+
+  // close stops the running model before unmapping the registers.
+  dev.close ();
+  if (dev.model_pid () != -1 || dev.valid () || dev.stop ())
+    return false;
+
+  // an exception in the model ends the model process only.
+  if (!dev.create (name) || dev.spawn (throwing_model) <= 0)
+    return false;
+  dev.regs ().cmd = 2;
+  dev.doorbell ();
+  return dev.stop ();
+}
+
+int main (void)
+{
+  char name[64];
+  const int pid = static_cast<int> (::getpid ());
+
+  std::snprintf (name, sizeof (name), "/hw_reg_vdev_calc_%d", pid);
+  if (!check_calc (name))
+    return 1;
+
+  std::snprintf (name, sizeof (name), "/hw_reg_vdev_dma_%d", pid);
+  if (!check_dma (name))
+    return 2;
+
+  std::snprintf (name, sizeof (name), "/hw_reg_vdev_attach_%d", pid);
+  if (!check_attach (name))
+    return 3;
+
+  std::snprintf (name, sizeof (name), "/hw_reg_vdev_close_%d", pid);
+  if (!check_close (name))
+    return 4;
+
+  return 0;
+}
@@ -0,0 +1,273 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register memory window C++ class
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+
+This source code uses C++11 language and library features and thus requires
+a compiler and an STL implementation that supports C++11.
+
+Known to work:
+  GCC 12, libstdc++-v3
+
+--------------------------------------------------------------------------------
+
+The register window is a large device memory aperture, e.g. a PCI BAR that
+holds packet buffers or a firmware upload area.  Copying data into such a
+window with a loop over 32-bit registers results in one small uncached store
+per word.  The window copies use the widest naturally aligned accesses
+instead:
+
+  hw_reg_window<hw_reg_window_wc> fw (bar2, bar2_size);	// write-combining
+
+  fw.copy_to (0, image, image_size);	// non-temporal vector stores + sfence
+  fw.copy_from (buf, 0x1000, 256);	// vector loads
+
+The mapping type selects the store instructions:
+
+  - hw_reg_window_wc: for write-combining mappings.  The aligned middle part
+    of a copy is written with non-temporal stores (AVX or SSE2), which fill
+    the write-combining buffers in full lines.  Loads use non-temporal
+    vector loads if SSE4.1 is available.
+  - hw_reg_window_uc: for uncached mappings, or devices that do not accept
+    write-combined accesses.  The same widths are used with ordinary stores.
+
+The vector width is chosen at compile time (e.g. -mavx selects 32-byte
+accesses).  The unaligned head and tail of a copy use naturally aligned
+1, 2, 4, 8 and 16 byte accesses.  A device that only accepts some of these
+widths must be given correspondingly aligned offsets and lengths.
+
+copy_to finishes with flush, which makes all stores to the window globally
+visible (sfence for write-combining mappings).  Several pieces can be
+written with store and flushed once.
+
+--------------------------------------------------------------------------------
+*/
+
+#ifndef __HWREG_WINDOW_HEADER_INCLUDED__
+#define __HWREG_WINDOW_HEADER_INCLUDED__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <atomic>
+
+#if defined (__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifndef __HW_REG_BEGIN_NAMESPACE__
+#define __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifndef __HW_REG_END_NAMESPACE__
+#define __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#define __HW_REG_END_NAMESPACE__
+#endif
+
+__HW_REG_BEGIN_NAMESPACE__
+
+struct hw_reg_window_uc { static constexpr bool non_temporal = false; };
+struct hw_reg_window_wc { static constexpr bool non_temporal = true; };
+
+// widest access type of the target.
+#if defined (__AVX__)
+typedef __m256i hw_reg_window_vector;
+#elif defined (__SSE2__)
+typedef __m128i hw_reg_window_vector;
+#else
+typedef uint64_t hw_reg_window_vector;
+#endif
+
+template <typename Mapping = hw_reg_window_wc> class hw_reg_window
+{
+public:
+  typedef Mapping mapping_type;
+  typedef hw_reg_window_vector vector_type;
+
+  static constexpr std::size_t vector_size = sizeof (vector_type);
+
+  hw_reg_window (void* base, std::size_t size) noexcept
+    : __base (static_cast<unsigned char*> (base)), __size (size)
+  { }
+
+  hw_reg_window (const hw_reg_window&) = delete;
+  hw_reg_window& operator = (const hw_reg_window&) = delete;
+
+  std::size_t size (void) const noexcept { return __size; }
+  void* data (void) const noexcept { return __base; }
+
+  // write n bytes at the window offset without the final fence.
+  // offset + n must not exceed the window size.
+  void store (std::size_t offset, const void* src, std::size_t n) noexcept
+  {
+    unsigned char* d = __base + offset;
+    const unsigned char* s = static_cast<const unsigned char*> (src);
+
+    // head up to the vector alignment.
+    if ((reinterpret_cast<uintptr_t> (d) & 1) && n >= 1) { put<uint8_t> (d, s); d += 1; s += 1; n -= 1; }
+    if ((reinterpret_cast<uintptr_t> (d) & 2) && n >= 2) { put<uint16_t> (d, s); d += 2; s += 2; n -= 2; }
+    if ((reinterpret_cast<uintptr_t> (d) & 4) && n >= 4) { put<uint32_t> (d, s); d += 4; s += 4; n -= 4; }
+    if (vector_size > 8 && (reinterpret_cast<uintptr_t> (d) & 8) && n >= 8) { put<uint64_t> (d, s); d += 8; s += 8; n -= 8; }
+#if defined (__AVX__)
+    if ((reinterpret_cast<uintptr_t> (d) & 16) && n >= 16) { put<__m128i> (d, s); d += 16; s += 16; n -= 16; }
+#endif
+
+    for (; n >= 4 * vector_size; n -= 4 * vector_size, d += 4 * vector_size, s += 4 * vector_size)
+    {
+      put<vector_type> (d + 0 * vector_size, s + 0 * vector_size);
+      put<vector_type> (d + 1 * vector_size, s + 1 * vector_size);
+      put<vector_type> (d + 2 * vector_size, s + 2 * vector_size);
+      put<vector_type> (d + 3 * vector_size, s + 3 * vector_size);
+    }
+    for (; n >= vector_size; n -= vector_size, d += vector_size, s += vector_size)
+      put<vector_type> (d, s);
+
+    // tail with decreasing widths, all of them aligned.
+#if defined (__AVX__)
+    if (n >= 16) { put<__m128i> (d, s); d += 16; s += 16; n -= 16; }
+#endif
+    if (vector_size > 8 && n >= 8) { put<uint64_t> (d, s); d += 8; s += 8; n -= 8; }
+    if (n >= 4) { put<uint32_t> (d, s); d += 4; s += 4; n -= 4; }
+    if (n >= 2) { put<uint16_t> (d, s); d += 2; s += 2; n -= 2; }
+    if (n >= 1) put<uint8_t> (d, s);
+  }
+
+  // make all previous stores to the window globally visible.
+  void flush (void) noexcept
+  {
+#if defined (__SSE2__)
+    if (Mapping::non_temporal)
+    {
+      _mm_sfence ();
+      return;
+    }
+#endif
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+  }
+
+  void copy_to (std::size_t offset, const void* src, std::size_t n) noexcept
+  {
+    store (offset, src, n);
+    flush ();
+  }
+
+  // read n bytes at the window offset.
+  void copy_from (void* dst, std::size_t offset, std::size_t n) const noexcept
+  {
+    const unsigned char* s = __base + offset;
+    unsigned char* d = static_cast<unsigned char*> (dst);
+
+    if ((reinterpret_cast<uintptr_t> (s) & 1) && n >= 1) { get<uint8_t> (d, s); d += 1; s += 1; n -= 1; }
+    if ((reinterpret_cast<uintptr_t> (s) & 2) && n >= 2) { get<uint16_t> (d, s); d += 2; s += 2; n -= 2; }
+    if ((reinterpret_cast<uintptr_t> (s) & 4) && n >= 4) { get<uint32_t> (d, s); d += 4; s += 4; n -= 4; }
+    if (vector_size > 8 && (reinterpret_cast<uintptr_t> (s) & 8) && n >= 8) { get<uint64_t> (d, s); d += 8; s += 8; n -= 8; }
+#if defined (__AVX__)
+    if ((reinterpret_cast<uintptr_t> (s) & 16) && n >= 16) { get<__m128i> (d, s); d += 16; s += 16; n -= 16; }
+#endif
+
+    for (; n >= vector_size; n -= vector_size, d += vector_size, s += vector_size)
+      get<vector_type> (d, s);
+
+#if defined (__AVX__)
+    if (n >= 16) { get<__m128i> (d, s); d += 16; s += 16; n -= 16; }
+#endif
+    if (vector_size > 8 && n >= 8) { get<uint64_t> (d, s); d += 8; s += 8; n -= 8; }
+    if (n >= 4) { get<uint32_t> (d, s); d += 4; s += 4; n -= 4; }
+    if (n >= 2) { get<uint16_t> (d, s); d += 2; s += 2; n -= 2; }
+    if (n >= 1) get<uint8_t> (d, s);
+  }
+
+private:
+  // aligned store of one T from unaligned source memory.
+  template <typename T> static void put (unsigned char* d, const unsigned char* s) noexcept
+  {
+    T v;
+    std::memcpy (&v, s, sizeof (T));
+    put_aligned (reinterpret_cast<T*> (d), v, std::integral_constant<bool, Mapping::non_temporal> ());
+  }
+
+  // small accesses are ordinary stores for both mapping types.
+  template <typename T, typename NT> static void put_aligned (T* d, const T& v, NT) noexcept
+  {
+    *const_cast<volatile T*> (d) = v;
+  }
+
+#if defined (__SSE2__)
+  static void put_aligned (__m128i* d, const __m128i& v, std::true_type) noexcept { _mm_stream_si128 (d, v); }
+#endif
+#if defined (__AVX__)
+  static void put_aligned (__m256i* d, const __m256i& v, std::true_type) noexcept { _mm256_stream_si256 (d, v); }
+#endif
+
+  // aligned load of one T into unaligned destination memory.
+  template <typename T> static void get (unsigned char* d, const unsigned char* s) noexcept
+  {
+    const T v = get_aligned (reinterpret_cast<const T*> (s), std::integral_constant<bool, Mapping::non_temporal> ());
+    std::memcpy (d, &v, sizeof (T));
+  }
+
+  template <typename T, typename NT> static T get_aligned (const T* s, NT) noexcept
+  {
+    return *const_cast<const volatile T*> (s);
+  }
+
+#if defined (__SSE4_1__)
+  static __m128i get_aligned (const __m128i* s, std::true_type) noexcept
+  {
+    return _mm_stream_load_si128 (const_cast<__m128i*> (s));
+  }
+#endif
+#if defined (__AVX2__)
+  static __m256i get_aligned (const __m256i* s, std::true_type) noexcept
+  {
+    return _mm256_stream_load_si256 (const_cast<__m256i*> (s));
+  }
+#endif
+
+  unsigned char* const __base;
+  const std::size_t __size;
+};
+
+__HW_REG_END_NAMESPACE__
+
+#ifdef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_BEGIN_NAMESPACE__
+#endif
+
+#ifdef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE_DO_UNDEF_AFTER__
+#undef __HW_REG_END_NAMESPACE__
+#endif
+
+#endif // __HWREG_WINDOW_HEADER_INCLUDED__
@@ -0,0 +1,197 @@
+/*
+--------------------------------------------------------------------------------
+
+Hardware Register memory window tests
+
+Copyright (c) 2012, Oleg Endo
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of the copyright holders nor the names of any
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+--------------------------------------------------------------------------------
+Example how to compile this file:
+  g++ -std=c++11 -O2 hw_reg_window_compile_tests.cpp
+  g++ -std=c++11 -O2 -mavx2 hw_reg_window_compile_tests.cpp
+
+A shared mapping of a temporary file stands in for the device memory window.
+The resulting executable returns a non-zero exit code if a test fails.
+
+--------------------------------------------------------------------------------
+*/
+
+
+#define __HW_REG_BEGIN_NAMESPACE__ namespace test_namespace {
+#define __HW_REG_END_NAMESPACE__ }
+#define __HW_REG_USE_NAMESPACE test_namespace::
+
+#include "hw_reg_window.hpp"
+#include "hw_reg.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace test_namespace;
+
+// non-temporal vector stores, sfence at the end.
+void test_00 (hw_reg_window<hw_reg_window_wc>& w, const void* src, std::size_t n)
+{
+  w.copy_to (0, src, n);
+}
+
+// ordinary vector stores, full fence at the end.
+void test_01 (hw_reg_window<hw_reg_window_uc>& w, const void* src, std::size_t n)
+{
+  w.copy_to (0, src, n);
+}
+
+void test_02 (const hw_reg_window<hw_reg_window_wc>& w, void* dst, std::size_t n)
+{
+  w.copy_from (dst, 0, n);
+}
+
+static const std::size_t window_size = 1 << 20;
+
+static int window_fd = -1;
+static unsigned char* window_mem = nullptr;
+
+static bool open_window (void)
+{
+  char name[] = "/tmp/hw_reg_window_XXXXXX";
+  window_fd = mkstemp (name);
+  if (window_fd < 0)
+    return false;
+  unlink (name);
+
+  if (ftruncate (window_fd, window_size) != 0)
+    return false;
+
+  void* p = mmap (nullptr, window_size, PROT_READ | PROT_WRITE, MAP_SHARED, window_fd, 0);
+  if (p == MAP_FAILED)
+    return false;
+
+  window_mem = static_cast<unsigned char*> (p);
+  return true;
+}
+
+// every offset and length combination around the vector alignment.  the
+// result is read back through the file, not through the mapping.
+template <typename Mapping> static bool check_copy_to (void)
+{
+  hw_reg_window<Mapping> w (window_mem, window_size);
+  unsigned char src[512];
+  unsigned char file[768];
+
+  for (std::size_t i = 0; i < sizeof (src); ++i)
+    src[i] = static_cast<unsigned char> (i * 7 + 3);
+
+  for (std::size_t offset = 0; offset < 64; ++offset)
+    for (std::size_t n = 0; n <= 300; ++n)
+    {
+      std::memset (window_mem, 0xEE, sizeof (file));
+      w.copy_to (offset, src + 1, n);
+
+      if (pread (window_fd, file, sizeof (file), 0) != sizeof (file))
+	return false;
+
+      for (std::size_t i = 0; i < sizeof (file); ++i)
+      {
+	const unsigned char expected = i >= offset && i < offset + n ? src[1 + i - offset] : 0xEE;
+	if (file[i] != expected)
+	  return false;
+      }
+    }
+
+  return true;
+}
+
+template <typename Mapping> static bool check_copy_from (void)
+{
+  const hw_reg_window<Mapping> w (window_mem, window_size);
+  unsigned char dst[512];
+
+  for (std::size_t i = 0; i < 768; ++i)
+    window_mem[i] = static_cast<unsigned char> (i * 13 + 5);
+
+  for (std::size_t offset = 0; offset < 64; ++offset)
+    for (std::size_t n = 0; n <= 300; ++n)
+    {
+      std::memset (dst, 0xEE, sizeof (dst));
+      w.copy_from (dst + 1, offset, n);
+
+      for (std::size_t i = 0; i < sizeof (dst); ++i)
+      {
+	const unsigned char expected = i >= 1 && i < 1 + n ? window_mem[offset + i - 1] : 0xEE;
+	if (dst[i] != expected)
+	  return false;
+      }
+    }
+
+  return true;
+}
+
+// informational only, the file mapping is cached memory.
+static void compare_word_loop (void)
+{
+  typedef hw_reg_w<uint32_t> word_reg;
+  static uint32_t image[window_size / 4];
+  for (std::size_t i = 0; i < window_size / 4; ++i)
+    image[i] = static_cast<uint32_t> (i);
+
+  hw_reg_window<hw_reg_window_wc> w (window_mem, window_size);
+  word_reg* regs = reinterpret_cast<word_reg*> (window_mem);
+
+  double loop_ns = 1e30, copy_ns = 1e30;
+  for (int round = 0; round < 5; ++round)
+  {
+    const auto t0 = std::chrono::steady_clock::now ();
+    for (std::size_t i = 0; i < window_size / 4; ++i)
+      regs[i] = image[i];
+    const auto t1 = std::chrono::steady_clock::now ();
+    w.copy_to (0, image, window_size);
+    const auto t2 = std::chrono::steady_clock::now ();
+
+    loop_ns = std::min (loop_ns, std::chrono::duration<double, std::nano> (t1 - t0).count ());
+    copy_ns = std::min (copy_ns, std::chrono::duration<double, std::nano> (t2 - t1).count ());
+  }
+
+  std::printf ("1 MiB: hw_reg_w<uint32_t> loop %.0f us, copy_to %.0f us (%u byte vectors)\n",
+	       loop_ns / 1000, copy_ns / 1000, unsigned (hw_reg_window<>::vector_size));
+}
+
+int main (void)
+{
+  if (!open_window ())
+    return 1;
+  if (!check_copy_to<hw_reg_window_wc> () || !check_copy_to<hw_reg_window_uc> ())
+    return 2;
+  if (!check_copy_from<hw_reg_window_wc> () || !check_copy_from<hw_reg_window_uc> ())
+    return 3;
+
+  compare_word_loop ();
+  return 0;
+}